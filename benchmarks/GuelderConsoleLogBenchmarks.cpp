@@ -0,0 +1,257 @@
+#include "../include/GuelderConsoleLog.hpp"
+#include "../include/GuelderConsoleLogSinks.hpp"
+#include "../include/GuelderConsoleLogBinary.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <barrier>
+
+//prints one JSON object per line to the standard output: benchmark, output, threads, calls, ns_per_call, p50_ns, p99_ns, p999_ns
+namespace GuelderConsoleLog
+{
+    GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR(Bench, All, true, false, false);
+    GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR(BenchTime, All, true, false, true);
+    GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR(BenchDisabled, All, false, false, false);
+    GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR(BenchMuted, All, true, false, false);
+}
+
+namespace
+{
+    using namespace GuelderConsoleLog;
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings final
+    {
+        size_t iterations = 200'000;
+        size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        std::filesystem::path filePath = std::filesystem::temp_directory_path() / "GuelderConsoleLogBenchmarks.log";
+        std::filesystem::path binaryPath = std::filesystem::temp_directory_path() / "GuelderConsoleLogBenchmarks.bin";
+    };
+
+    struct Result final
+    {
+        std::string_view benchmark;
+        std::string_view output;
+        size_t threads = 1;
+        size_t calls = 0;
+        double nsPerCall = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+    };
+
+    void Print(const Result& result)
+    {
+        std::printf("{\"benchmark\":\"%.*s\",\"output\":\"%.*s\",\"threads\":%zu,\"calls\":%zu,\"ns_per_call\":%.2f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"p999_ns\":%.1f}\n",
+            static_cast<int>(result.benchmark.size()), result.benchmark.data(), static_cast<int>(result.output.size()), result.output.data(),
+            result.threads, result.calls, result.nsPerCall, result.p50, result.p99, result.p999);
+        std::fflush(stdout);
+    }
+
+    double GetPercentile(std::vector<int64_t>& latencies, const double& percentile)
+    {
+        if(latencies.empty())
+            return 0.0;
+
+        const auto nth = latencies.begin() + static_cast<ptrdiff_t>(percentile * static_cast<double>(latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+
+        return static_cast<double>(*nth);
+    }
+
+    /**
+     * \return Cost of reading the clock twice, is subtracted from every latency.
+     */
+    int64_t MeasureClockOverhead()
+    {
+        std::vector<int64_t> samples(10'000);
+        for(auto& sample : samples)
+        {
+            const auto begin = Clock::now();
+            const auto end = Clock::now();
+            sample = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+        }
+
+        return static_cast<int64_t>(GetPercentile(samples, 0.5));
+    }
+
+    //untimed calls before the measured ones, they pay for the first-use allocations(e.g. per-thread buffers)
+    constexpr size_t warmUpIterations = 10'000;
+
+    /**
+     * \brief Runs call on every thread: first a warm-up, then iterations times in a row for ns/call, then the same count timing every call for the percentiles.
+     */
+    template<typename Call>
+    Result Run(const std::string_view& benchmark, const std::string_view& output, const size_t& threadsCount, const size_t& iterations, const int64_t& clockOverhead, const Call& call)
+    {
+        std::vector<std::vector<int64_t>> latencies(threadsCount, std::vector<int64_t>(iterations));
+        std::vector<int64_t> durations(threadsCount);
+        std::barrier start{ static_cast<ptrdiff_t>(threadsCount) };
+
+        const auto work = [&](const size_t& thread)
+            {
+                for(size_t i = 0; i < std::min(iterations, warmUpIterations); ++i)
+                    call(i);
+
+                start.arrive_and_wait();
+
+                const auto begin = Clock::now();
+                for(size_t i = 0; i < iterations; ++i)
+                    call(i);
+                durations[thread] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+                start.arrive_and_wait();
+
+                for(size_t i = 0; i < iterations; ++i)
+                {
+                    const auto callBegin = Clock::now();
+                    call(i);
+                    const auto callEnd = Clock::now();
+
+                    latencies[thread][i] = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(callEnd - callBegin).count() - clockOverhead, 0);
+                }
+            };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < threadsCount; ++i)
+            threads.emplace_back(work, i);
+        work(0);
+        for(auto& thread : threads)
+            thread.join();
+
+        Logger::Flush();
+
+        std::vector<int64_t> all;
+        all.reserve(threadsCount * iterations);
+        for(const auto& threadLatencies : latencies)
+            all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+
+        Result result{ benchmark, output, threadsCount, threadsCount * iterations };
+        //every thread makes the same count of calls, so the slowest one defines the throughput
+        result.nsPerCall = static_cast<double>(*std::max_element(durations.begin(), durations.end())) / static_cast<double>(iterations);
+        result.p50 = GetPercentile(all, 0.5);
+        result.p99 = GetPercentile(all, 0.99);
+        result.p999 = GetPercentile(all, 0.999);
+
+        return result;
+    }
+
+    Settings ParseSettings(const int& argc, char** argv)
+    {
+        Settings settings;
+
+        for(int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string_view name = argv[i];
+
+            if(name == "--iterations")
+                settings.iterations = std::strtoull(argv[i + 1], nullptr, 10);
+            else if(name == "--threads")
+                settings.maxThreads = std::strtoull(argv[i + 1], nullptr, 10);
+            else if(name == "--file")
+                settings.filePath = argv[i + 1];
+            else
+            {
+                std::fprintf(stderr, "usage: GuelderConsoleLogBenchmarks [--iterations N] [--threads N] [--file path]\n");
+                std::exit(1);
+            }
+        }
+
+        //the contention benchmark gives every thread iterations / threads calls
+        if(settings.maxThreads == 0 || settings.iterations < settings.maxThreads)
+        {
+            std::fprintf(stderr, "--threads must be at least 1 and --iterations must be at least --threads\n");
+            std::exit(1);
+        }
+
+        return settings;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const Settings settings = ParseSettings(argc, argv);
+    const size_t iterations = settings.iterations;
+    const int64_t clockOverhead = MeasureClockOverhead();
+
+#ifdef WIN32
+    const std::filesystem::path nullPath = "NUL";
+#else
+    const std::filesystem::path nullPath = "/dev/null";
+#endif
+
+    const std::pair<std::string_view, std::shared_ptr<Sink>> outputs[] =
+    {
+        { "null", std::make_shared<FileSink>(nullPath) },
+        { "file", std::make_shared<FileSink>(settings.filePath) }
+    };
+
+    Print(Run("Format", "none", 1, iterations, clockOverhead, [](const size_t& i)
+        {
+            const auto text = Logger::Format("id=", i, " value=", static_cast<double>(i) * 0.5, ' ', true, " name=", std::string_view{ "benchmark" });
+            if(text.empty())
+                std::abort();
+        }));
+
+    Print(Run("GE_LOG disabled category", "none", 1, iterations, clockOverhead, [](const size_t& i)
+        {
+            GE_LOG(BenchDisabled, Info, "id=", i, " value=", static_cast<double>(i) * 0.5);
+        }));
+
+    GE_SET_LOG_LEVEL(BenchMuted, Error);
+    Print(Run("GE_LOG below runtime level", "none", 1, iterations, clockOverhead, [](const size_t& i)
+        {
+            GE_LOG(BenchMuted, Info, "id=", i, " value=", static_cast<double>(i) * 0.5);
+        }));
+
+    for(const auto& [output, sink] : outputs)
+    {
+        Logger::SetDefaultSinks({ sink });
+
+        Print(Run("GE_LOG", output, 1, iterations, clockOverhead, [](const size_t& i)
+            {
+                GE_LOG(Bench, Info, "id=", i, " value=", static_cast<double>(i) * 0.5, " name=", "benchmark");
+            }));
+        Print(Run("GE_LOG writeTime", output, 1, iterations, clockOverhead, [](const size_t& i)
+            {
+                GE_LOG(BenchTime, Info, "id=", i, " value=", static_cast<double>(i) * 0.5, " name=", "benchmark");
+            }));
+        Print(Run("GE_LOG wide", output, 1, iterations, clockOverhead, [](const size_t& i)
+            {
+                GE_LOG(Bench, Info, L"id=", i, L" value=", static_cast<double>(i) * 0.5, L" name=", L"ключ");
+            }));
+
+        //powers of two and the max count itself
+        for(size_t threads = 1; ; threads = std::min(threads * 2, settings.maxThreads))
+        {
+            Print(Run("GE_LOG contention", output, threads, iterations / threads, clockOverhead, [](const size_t& i)
+                {
+                    GE_LOG(Bench, Info, "id=", i, " value=", static_cast<double>(i) * 0.5, " name=", "benchmark");
+                }));
+
+            if(threads == settings.maxThreads)
+                break;
+        }
+    }
+
+    Logger::SetDefaultSinks({ outputs[0].second });
+
+    BinaryLogger::Options binaryOptions;
+    binaryOptions.stagingBufferSize = 16 << 20;
+    BinaryLogger::Start(settings.binaryPath, binaryOptions);
+
+    Print(Run("GE_LOG_BINARY", "file", 1, iterations, clockOverhead, [](const size_t& i)
+        {
+            GE_LOG_BINARY(Bench, Info, "id=", i, " value=", static_cast<double>(i) * 0.5, " name=", "benchmark");
+        }));
+
+    BinaryLogger::Stop();
+
+    std::error_code error;
+    std::filesystem::remove(settings.binaryPath, error);
+
+    return 0;
+}
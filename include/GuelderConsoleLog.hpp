@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GuelderConsoleLogMacroses.hpp"
+#include "GuelderConsoleLogQueue.hpp"
 
 #ifdef WIN32
 #include <Windows.h>
@@ -11,178 +12,1397 @@
 #include <string_view>
 #include <string>
 #include <sstream>
+#include <charconv>
+#include <iterator>
 #include <chrono>
+#include <ctime>
+#include <limits>
+#include <atomic>
 #include <type_traits>
 #include <functional>
+#include <array>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 //enums of color attributes
 namespace GuelderConsoleLog
 {
-    enum class ConsoleForegroundColor : uint16_t
+    /**
+     * \brief Bits of Windows console attributes, on other platforms colors are kept the same way. They are converted to ANSI sequences anyway.
+     */
+    namespace ConsoleAttributes
     {
-        Black = 0
+        constexpr uint16_t foregroundBlue = 0x0001;
+        constexpr uint16_t foregroundGreen = 0x0002;
+        constexpr uint16_t foregroundRed = 0x0004;
+        constexpr uint16_t foregroundIntensity = 0x0008;
+        constexpr uint16_t backgroundBlue = 0x0010;
+        constexpr uint16_t backgroundGreen = 0x0020;
+        constexpr uint16_t backgroundRed = 0x0040;
+        constexpr uint16_t backgroundIntensity = 0x0080;
+
 #ifdef WIN32
-        ,
-        Blue = FOREGROUND_BLUE,
-        Green = FOREGROUND_GREEN,
-        Cyan = FOREGROUND_GREEN | FOREGROUND_BLUE,
-        Red = FOREGROUND_RED,
-        Magenta = FOREGROUND_RED | FOREGROUND_BLUE,
-        Yellow = FOREGROUND_RED | FOREGROUND_GREEN,
-        White = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE,
-        Gray = FOREGROUND_INTENSITY,
-        BrightBlue = FOREGROUND_BLUE | FOREGROUND_INTENSITY,
-        BrightGreen = FOREGROUND_GREEN | FOREGROUND_INTENSITY,
-        BrightCyan = FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
-        BrightRed = FOREGROUND_RED | FOREGROUND_INTENSITY,
-        BrightMagenta = FOREGROUND_RED | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
-        BrightYellow = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY,
-        BrightWhite = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY
+        static_assert(foregroundBlue == FOREGROUND_BLUE && foregroundGreen == FOREGROUND_GREEN && foregroundRed == FOREGROUND_RED && foregroundIntensity == FOREGROUND_INTENSITY);
+        static_assert(backgroundBlue == BACKGROUND_BLUE && backgroundGreen == BACKGROUND_GREEN && backgroundRed == BACKGROUND_RED && backgroundIntensity == BACKGROUND_INTENSITY);
 #endif
+    }
+
+    enum class ConsoleForegroundColor : uint16_t
+    {
+        Black = 0,
+        Blue = ConsoleAttributes::foregroundBlue,
+        Green = ConsoleAttributes::foregroundGreen,
+        Cyan = ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundBlue,
+        Red = ConsoleAttributes::foregroundRed,
+        Magenta = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundBlue,
+        Yellow = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundGreen,
+        White = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundBlue,
+        Gray = ConsoleAttributes::foregroundIntensity,
+        BrightBlue = ConsoleAttributes::foregroundBlue | ConsoleAttributes::foregroundIntensity,
+        BrightGreen = ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundIntensity,
+        BrightCyan = ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundBlue | ConsoleAttributes::foregroundIntensity,
+        BrightRed = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundIntensity,
+        BrightMagenta = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundBlue | ConsoleAttributes::foregroundIntensity,
+        BrightYellow = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundIntensity,
+        BrightWhite = ConsoleAttributes::foregroundRed | ConsoleAttributes::foregroundGreen | ConsoleAttributes::foregroundBlue | ConsoleAttributes::foregroundIntensity
     };
 
     enum class ConsoleBackgroundColor : uint16_t
     {
-        Black = 0
-#ifdef WIN32
-        ,
-        Blue = BACKGROUND_BLUE,
-        Green = BACKGROUND_GREEN,
-        Cyan = BACKGROUND_GREEN | BACKGROUND_BLUE,
-        Red = BACKGROUND_RED,
-        Magenta = BACKGROUND_RED | BACKGROUND_BLUE,
-        Yellow = BACKGROUND_RED | BACKGROUND_GREEN,
-        White = BACKGROUND_RED | BACKGROUND_GREEN | BACKGROUND_BLUE
-#endif
+        Black = 0,
+        Blue = ConsoleAttributes::backgroundBlue,
+        Green = ConsoleAttributes::backgroundGreen,
+        Cyan = ConsoleAttributes::backgroundGreen | ConsoleAttributes::backgroundBlue,
+        Red = ConsoleAttributes::backgroundRed,
+        Magenta = ConsoleAttributes::backgroundRed | ConsoleAttributes::backgroundBlue,
+        Yellow = ConsoleAttributes::backgroundRed | ConsoleAttributes::backgroundGreen,
+        White = ConsoleAttributes::backgroundRed | ConsoleAttributes::backgroundGreen | ConsoleAttributes::backgroundBlue
     };
 }
 
 //strings converting
 namespace GuelderConsoleLog
 {
+    namespace Transcoding
+    {
+        constexpr uint32_t replacementCharacter = 0xFFFD;
+
+#ifdef GE_SSE2
+        [[nodiscard]]
+        inline bool IsZero(const __m128i& value)
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) == 0xFFFF;
+        }
+#endif
+
+        /**
+         * \brief Copies the leading ASCII bytes to out as wchar_t with SIMD, stops before the first block with a non-ASCII byte.
+         * \return Count of copied bytes, the rest is left for the scalar code.
+         */
+        inline size_t WidenASCII(const char* in, const size_t& size, wchar_t* out)
+        {
+            size_t i = 0;
+
+#ifdef __AVX2__
+            for(; i + 32 <= size; i += 32)
+            {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+
+                if(_mm256_movemask_epi8(bytes) != 0)
+                    break;
+
+                if constexpr(sizeof(wchar_t) == 2)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+                }
+                else
+                {
+                    for(size_t j = 0; j < 32; j += 8)
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + j), _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i + j))));
+                }
+            }
+#endif
+#ifdef GE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+
+            for(; i + 16 <= size; i += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+
+                if(_mm_movemask_epi8(bytes) != 0)
+                    break;
+
+                const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+                if constexpr(sizeof(wchar_t) == 2)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), low);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), high);
+                }
+                else
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi16(low, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(low, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpacklo_epi16(high, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_unpackhi_epi16(high, zero));
+                }
+            }
+#endif
+
+            return i;
+        }
+        /**
+         * \brief Copies the leading ASCII wchar_t to out as bytes with SIMD, stops before the first block with a non-ASCII one.
+         * \return Count of copied wchar_t, the rest is left for the scalar code.
+         */
+        inline size_t NarrowASCII(const wchar_t* in, const size_t& size, char* out)
+        {
+            size_t i = 0;
+
+#ifdef GE_SSE2
+            if constexpr(sizeof(wchar_t) == 2)
+            {
+                const __m128i nonASCII = _mm_set1_epi16(static_cast<short>(0xFF80));
+
+                for(; i + 16 <= size; i += 16)
+                {
+                    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+
+                    if(!IsZero(_mm_and_si128(_mm_or_si128(first, second), nonASCII)))
+                        break;
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(first, second));
+                }
+            }
+            else
+            {
+                const __m128i nonASCII = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+
+                for(; i + 16 <= size; i += 16)
+                {
+                    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4));
+                    const __m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+                    const __m128i fourth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+
+                    if(!IsZero(_mm_and_si128(_mm_or_si128(_mm_or_si128(first, second), _mm_or_si128(third, fourth)), nonASCII)))
+                        break;
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(_mm_packs_epi32(first, second), _mm_packs_epi32(third, fourth)));
+                }
+            }
+#endif
+
+            return i;
+        }
+
+        /**
+         * \brief Decodes one UTF-8 sequence starting at in[i], which isn't ASCII. Invalid or truncated sequences decode as replacementCharacter and consume one byte.
+         */
+        inline uint32_t DecodeUTF8(const std::string_view& in, size_t& i)
+        {
+            const uint8_t first = static_cast<uint8_t>(in[i]);
+
+            size_t length;
+            uint32_t codePoint;
+            uint32_t minCodePoint;
+
+            if(first >= 0xC2 && first <= 0xDF)
+            {
+                length = 2;
+                codePoint = first & 0x1F;
+                minCodePoint = 0x80;
+            }
+            else if(first >= 0xE0 && first <= 0xEF)
+            {
+                length = 3;
+                codePoint = first & 0x0F;
+                minCodePoint = 0x800;
+            }
+            else if(first >= 0xF0 && first <= 0xF4)
+            {
+                length = 4;
+                codePoint = first & 0x07;
+                minCodePoint = 0x10000;
+            }
+            else
+            {
+                ++i;
+                return replacementCharacter;
+            }
+
+            if(in.size() - i < length)
+            {
+                ++i;
+                return replacementCharacter;
+            }
+
+            for(size_t j = 1; j < length; ++j)
+            {
+                const uint8_t continuation = static_cast<uint8_t>(in[i + j]);
+
+                if((continuation & 0xC0) != 0x80)
+                {
+                    ++i;
+                    return replacementCharacter;
+                }
+
+                codePoint = (codePoint << 6) | (continuation & 0x3F);
+            }
+
+            if(codePoint < minCodePoint || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+            {
+                ++i;
+                return replacementCharacter;
+            }
+
+            i += length;
+            return codePoint;
+        }
+    }
+
+    /**
+     * \brief Appends the UTF-8 string to out as UTF-16 if wchar_t is 2 bytes(Windows) and as UTF-32 otherwise, invalid sequences become U+FFFD.
+     * ASCII runs are converted with SSE2/AVX2 when they are available.
+     */
+    inline void AppendWide(std::wstring& out, const std::string_view& str)
+    {
+        const size_t begin = out.size();
+        //every code point takes at most as many wchar_t as its UTF-8 bytes
+        out.resize(begin + str.size());
+
+        wchar_t* destination = out.data() + begin;
+        size_t written = 0;
+        size_t i = 0;
+
+        while(i < str.size())
+        {
+            const size_t copied = Transcoding::WidenASCII(str.data() + i, str.size() - i, destination + written);
+            i += copied;
+            written += copied;
+
+            //the scalar part runs until the next ASCII byte after a non-ASCII one, so mixed text doesn't fall back to SIMD on every char
+            bool wasNonASCII = false;
+
+            while(i < str.size())
+            {
+                const uint8_t byte = static_cast<uint8_t>(str[i]);
+
+                if(byte < 0x80)
+                {
+                    if(wasNonASCII)
+                        break;
+
+                    destination[written++] = static_cast<wchar_t>(byte);
+                    ++i;
+                    continue;
+                }
+
+                wasNonASCII = true;
+
+                const uint32_t codePoint = Transcoding::DecodeUTF8(str, i);
+
+                if(sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+                {
+                    destination[written++] = static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+                    destination[written++] = static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+                }
+                else
+                    destination[written++] = static_cast<wchar_t>(codePoint);
+            }
+        }
+
+        out.resize(begin + written);
+    }
+
+    /**
+     * \brief Appends the wide string to out as UTF-8. wchar_t is treated as UTF-16 if it is 2 bytes(Windows) and as UTF-32 otherwise,
+     * invalid code units become U+FFFD. ASCII runs are converted with SSE2 when it is available.
+     */
+    inline void AppendUTF8(std::string& out, const std::wstring_view& wStr)
+    {
+        const size_t begin = out.size();
+        //a UTF-16 code unit takes at most 3 bytes(a surrogate pair - 4 bytes for 2 units), a UTF-32 one - 4
+        out.resize(begin + wStr.size() * (sizeof(wchar_t) == 2 ? 3 : 4));
+
+        char* destination = out.data() + begin;
+        size_t written = 0;
+        size_t i = 0;
+
+        while(i < wStr.size())
+        {
+            const size_t copied = Transcoding::NarrowASCII(wStr.data() + i, wStr.size() - i, destination + written);
+            i += copied;
+            written += copied;
+
+            bool wasNonASCII = false;
+
+            for(; i < wStr.size(); ++i)
+            {
+                uint32_t codePoint = static_cast<uint32_t>(wStr[i]);
+
+                if(codePoint < 0x80)
+                {
+                    if(wasNonASCII)
+                        break;
+
+                    destination[written++] = static_cast<char>(codePoint);
+                    continue;
+                }
+
+                wasNonASCII = true;
+
+                if constexpr(sizeof(wchar_t) == 2)
+                {
+                    if(codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < wStr.size())
+                    {
+                        const uint32_t low = static_cast<uint32_t>(wStr[i + 1]);
+
+                        if(low >= 0xDC00 && low <= 0xDFFF)
+                        {
+                            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                            ++i;
+                        }
+                    }
+                }
+
+                if((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+                    codePoint = Transcoding::replacementCharacter;
+
+                if(codePoint < 0x800)
+                {
+                    destination[written++] = static_cast<char>(0xC0 | (codePoint >> 6));
+                    destination[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                else if(codePoint < 0x10000)
+                {
+                    destination[written++] = static_cast<char>(0xE0 | (codePoint >> 12));
+                    destination[written++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    destination[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+                else
+                {
+                    destination[written++] = static_cast<char>(0xF0 | (codePoint >> 18));
+                    destination[written++] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                    destination[written++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                    destination[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+                }
+            }
+        }
+
+        out.resize(begin + written);
+    }
+
     /**
-     * \brief WARNING: This func only works properly with windows, because I don't give a fuck about Linux or MacOS.
+     * \brief Converts UTF-8 to UTF-16(Windows) or UTF-32(other platforms).
      */
     inline std::wstring StringToWString(const std::string_view& str)
     {
-#ifdef WIN32
-        const int neededSize = MultiByteToWideChar(CP_UTF8, 0, str.data(), - 1, nullptr, 0);
-        std::wstring wString(neededSize, L'\0');
-        MultiByteToWideChar(CP_UTF8, 0, str.data(), -1, wString.data(), neededSize);
+        std::wstring wString;
+        AppendWide(wString, str);
+
+        return wString;
+    }
+    /**
+     * \brief Converts UTF-16(Windows) or UTF-32(other platforms) to UTF-8.
+     */
+    inline std::string WStringToString(const std::wstring_view& wStr)
+    {
+        std::string string;
+        AppendUTF8(string, wStr);
+
+        return string;
+    }
+}
+
+//concepts
+namespace GuelderConsoleLog
+{
+#ifdef _MSC_VER
+    using DefaultException = std::exception;
 #else
-        std::wstring wString{};
+    //std::exception can be constructed from a message only with MSVC
+    using DefaultException = std::runtime_error;
 #endif
 
-        return wString;
-    }
+    template<typename T>
+    using RawType = std::remove_cv_t<std::remove_reference_t<std::remove_pointer_t<std::remove_extent_t<T>>>>;
+
+    namespace Concepts
+    {
+        template<typename T, typename U>
+        concept SameRawType = std::is_same_v<RawType<T>, RawType<U>>;
+
+        template<typename T>                     //idk why RawType<T>, because the same thing is made inside SameRawType, C++ blows my mind
+        concept IsWideChar = SameRawType<typename RawType<T>::value_type, wchar_t> || SameRawType<RawType<T>, wchar_t>;
+
+        //checked one by one, so a type without value_type doesn't make the whole pack narrow
+        template<typename... Args>
+        concept IsThereAtLeastOneWideChar = (IsWideChar<Args> || ...);
+
+        template<typename String, typename... Strings>
+        concept IsAtLeastOneSameRaw = (SameRawType<RawType<String>, Strings> || ...);
+
+        template<typename Char, typename T>
+        concept HasOutputOperator = (requires(std::basic_ostream<Char>&os, const T & t) { os << t; });
+
+        template<typename T>
+        concept STDCout = HasOutputOperator<char, T>;
+
+        template<typename T>
+        concept STDWout = HasOutputOperator<wchar_t, T> && !STDCout<T>;
+
+        template<typename T>
+        concept STDOut = STDCout<T> || STDWout<T>;
+
+        template<typename... Attributes>
+        concept ConsoleColorAttributes = (std::is_same_v<RawType<Attributes>, ConsoleForegroundColor> || ...) || (std::is_same_v<RawType<Attributes>, ConsoleBackgroundColor> || ...) || (std::is_same_v<RawType<Attributes>, uint16_t> || ...);
+
+        template<typename T>
+        concept IsException = (std::is_same_v<T, std::exception> || std::is_base_of_v<std::exception, T>) && (std::is_constructible_v<T, const std::string&> || std::is_constructible_v<T, const char*>);
+    }
+}
+
+//formatting
+namespace GuelderConsoleLog
+{
+    namespace Concepts
+    {
+        template<typename Char>
+        concept Character = std::is_same_v<Char, char> || std::is_same_v<Char, wchar_t>;
+
+        template<typename T>
+        concept CharLike = std::is_same_v<RawType<T>, char> || std::is_same_v<RawType<T>, signed char> || std::is_same_v<RawType<T>, unsigned char> || std::is_same_v<RawType<T>, wchar_t>;
+
+        template<typename T>
+        concept Number = (std::is_integral_v<std::remove_cvref_t<T>> || std::is_floating_point_v<std::remove_cvref_t<T>>) && !CharLike<std::remove_cvref_t<T>> && !std::is_same_v<std::remove_cvref_t<T>, bool>;
+
+        template<typename T, typename Char>
+        concept StringLike = std::is_convertible_v<const T&, std::basic_string_view<Char>> && !std::is_null_pointer_v<std::remove_cvref_t<T>>;
+
+        //the library's own types, which append themselves without a stream
+        template<typename T, typename Char>
+        concept SelfAppending = requires(const T& value, std::basic_string<Char>& out) { value.AppendTo(out); };
+    }
+
+    namespace Formatting
+    {
+        /**
+         * \brief Appends the value to the string the same way as std::basic_ostream<Char> would do it with default flags,
+         * but without a stream for bools, chars, numbers, strings and types with AppendTo. Other types go through operator<<.
+         */
+        template<Concepts::Character Char, typename T>
+        void Append(std::basic_string<Char>& out, const T& value)
+        {
+            using Type = std::remove_cvref_t<T>;
+
+            if constexpr(std::is_same_v<Type, bool>)
+                out.push_back(value ? Char('1') : Char('0'));
+            else if constexpr(Concepts::CharLike<Type> && !std::is_array_v<Type> && !std::is_pointer_v<Type>)
+            {
+                if constexpr(std::is_same_v<Char, char>)
+                    out.push_back(static_cast<char>(value));
+                else if constexpr(std::is_same_v<Type, wchar_t>)
+                    out.push_back(value);
+                else
+                    out.push_back(static_cast<wchar_t>(static_cast<unsigned char>(value)));
+            }
+            else if constexpr(Concepts::Number<Type>)
+            {
+                //enough for any integer and for a float with precision 6
+                char digits[64];
+                std::to_chars_result result;
+
+                if constexpr(std::is_floating_point_v<Type>)
+                    result = std::to_chars(std::begin(digits), std::end(digits), value, std::chars_format::general, 6);
+                else
+                    result = std::to_chars(std::begin(digits), std::end(digits), value);
+
+                out.append(digits, result.ptr);
+            }
+            else if constexpr(Concepts::StringLike<Type, Char>)
+            {
+                if constexpr(std::is_pointer_v<Type>)
+                    if(value == nullptr)
+                        return;
+
+                out.append(std::basic_string_view<Char>(value));
+            }
+            else if constexpr(std::is_same_v<Char, wchar_t> && Concepts::StringLike<Type, char>)
+            {
+                if constexpr(std::is_pointer_v<Type>)
+                    if(value == nullptr)
+                        return;
+
+                AppendWide(out, std::string_view{ value });
+            }
+            else if constexpr(Concepts::SelfAppending<Type, Char>)
+                value.AppendTo(out);
+            else
+            {
+                //reusing the stream saves its construction and locale lookups
+                thread_local std::basic_ostringstream<Char> stream;
+
+                stream.str({});
+                stream.clear();
+                stream << value;
+
+                out.append(stream.view());
+            }
+        }
+
+        /**
+         * \brief Appends the value to the UTF-8 string: narrow values as Append does it, wide strings and chars are transcoded directly,
+         * only types, which can be written only to std::wostream, go through a wide buffer.
+         */
+        template<typename T>
+        void AppendAsUTF8(std::string& out, const T& value);
+
+        /**
+         * \brief String with a fixed capacity, which can be built in a constant expression.
+         */
+        template<size_t capacity>
+        struct FixedString final
+        {
+            constexpr void push_back(const char& c)
+            {
+                data[size++] = c;
+            }
+            constexpr void append(const std::string_view& string)
+            {
+                for(const char& c : string)
+                    push_back(c);
+            }
+
+            [[nodiscard]]
+            constexpr std::string_view View() const
+            {
+                return { data, size };
+            }
+
+            char data[capacity]{};
+            size_t size = 0;
+        };
+
+        /**
+         * \brief Per-thread string, which keeps its capacity between log calls, so formatting doesn't allocate after warm up.
+         * If the thread's buffer is already taken(e.g. operator<< of a logged type logs something itself), a local string is used instead.
+         */
+        template<Concepts::Character Char>
+        class ThreadLocalBuffer final
+        {
+        public:
+            ThreadLocalBuffer()
+                : borrowed(!busy)
+            {
+                if(borrowed)
+                {
+                    busy = true;
+                    shared.clear();
+                }
+            }
+            ~ThreadLocalBuffer()
+            {
+                if(borrowed)
+                {
+                    if(shared.capacity() > maxRetainedCapacity)
+                    {
+                        shared.clear();
+                        shared.shrink_to_fit();
+                    }
+
+                    busy = false;
+                }
+            }
+
+            ThreadLocalBuffer(const ThreadLocalBuffer&) = delete;
+            ThreadLocalBuffer& operator=(const ThreadLocalBuffer&) = delete;
+
+            [[nodiscard]]
+            std::basic_string<Char>& Get()
+            {
+                return borrowed ? shared : local;
+            }
+
+        private:
+            //one huge message must not pin its memory for the whole thread lifetime
+            static constexpr size_t maxRetainedCapacity = 64 * 1024;
+
+            static inline thread_local std::basic_string<Char> shared;
+            static inline thread_local bool busy = false;
+
+            const bool borrowed;
+            std::basic_string<Char> local;
+        };
+
+        template<typename T>
+        void AppendAsUTF8(std::string& out, const T& value)
+        {
+            using Type = std::remove_cvref_t<T>;
+
+            if constexpr(std::is_same_v<Type, wchar_t>)
+                AppendUTF8(out, std::wstring_view{ &value, 1 });
+            else if constexpr(Concepts::StringLike<Type, wchar_t>)
+            {
+                if constexpr(std::is_pointer_v<Type>)
+                    if(value == nullptr)
+                        return;
+
+                AppendUTF8(out, std::wstring_view{ value });
+            }
+            else if constexpr(Concepts::STDCout<Type>)
+                Append(out, value);
+            else
+            {
+                ThreadLocalBuffer<wchar_t> wideBuffer;
+                Append(wideBuffer.Get(), value);
+
+                AppendUTF8(out, wideBuffer.Get());
+            }
+        }
+    }
+}
+
+//structured logging, is used by GE_LOG_KV
+namespace GuelderConsoleLog
+{
+    enum class StructuredFormat : uint8_t
+    {
+        //{"time":"12:00:00","category":"Core","level":"INFO","msg":"...","key":value}
+        JSON,
+        //time=12:00:00 category=Core level=INFO msg=... key=value
+        Logfmt
+    };
+
+    namespace Structured
+    {
+        /**
+         * \brief Appends the UTF-8 string as a JSON string literal.
+         */
+        inline void AppendJSONString(std::string& out, const std::string_view& string)
+        {
+            constexpr char hexDigits[] = "0123456789abcdef";
+
+            out.push_back('"');
+
+            size_t begin = 0;
+
+            for(size_t i = 0; i < string.size(); ++i)
+            {
+                const unsigned char c = static_cast<unsigned char>(string[i]);
+
+                if(c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+
+                out.append(string.substr(begin, i - begin));
+                begin = i + 1;
+
+                switch(c)
+                {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                case '\t':
+                    out.append("\\t");
+                    break;
+                default:
+                {
+                    const char escaped[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0x0F] };
+                    out.append(escaped, sizeof(escaped));
+                }
+                }
+            }
+
+            out.append(string.substr(begin));
+            out.push_back('"');
+        }
+        /**
+         * \brief Appends the string as a logfmt value: as is if it has no spaces, quotes, '=' or control chars, quoted and escaped otherwise.
+         */
+        inline void AppendLogfmtString(std::string& out, const std::string_view& string)
+        {
+            const bool needsQuotes = string.empty() || std::any_of(string.begin(), string.end(), [](const char& c) { return static_cast<unsigned char>(c) <= ' ' || c == '"' || c == '=' || c == '\\'; });
+
+            if(!needsQuotes)
+            {
+                out.append(string);
+                return;
+            }
+
+            //the same escaping as JSON is understood by logfmt parsers
+            AppendJSONString(out, string);
+        }
+
+        template<StructuredFormat format>
+        void AppendString(std::string& out, const std::string_view& string)
+        {
+            if constexpr(format == StructuredFormat::JSON)
+                AppendJSONString(out, string);
+            else
+                AppendLogfmtString(out, string);
+        }
+
+        /**
+         * \brief Bools and numbers are written as they are(non-finite floats as JSON null), everything else as a string.
+         */
+        template<StructuredFormat format, typename T>
+        void AppendValue(std::string& out, const T& value)
+        {
+            using Type = std::remove_cvref_t<T>;
+
+            if constexpr(std::is_same_v<Type, bool>)
+                out.append(value ? "true" : "false");
+            else if constexpr(Concepts::Number<Type>)
+            {
+                if constexpr(std::is_floating_point_v<Type>)
+                {
+                    if(format == StructuredFormat::JSON && !(value == value && value - value == 0))
+                    {
+                        out.append("null");
+                        return;
+                    }
+                }
+
+                Formatting::Append(out, value);
+            }
+            else if constexpr(Concepts::StringLike<Type, char>)
+            {
+                if constexpr(std::is_pointer_v<Type>)
+                {
+                    if(value == nullptr)
+                    {
+                        AppendString<format>(out, {});
+                        return;
+                    }
+                }
+
+                AppendString<format>(out, std::string_view{ value });
+            }
+            else if constexpr(std::is_same_v<Type, char> || std::is_same_v<Type, signed char> || std::is_same_v<Type, unsigned char>)
+            {
+                const char c = static_cast<char>(value);
+                AppendString<format>(out, std::string_view{ &c, 1 });
+            }
+            else
+            {
+                //wide strings and types with operator<< need their text first
+                Formatting::ThreadLocalBuffer<char> buffer;
+                Formatting::AppendAsUTF8(buffer.Get(), value);
+
+                AppendString<format>(out, buffer.Get());
+            }
+        }
+
+        /**
+         * \brief Appends ",\"key\":value" or " key=value". The first field of a line must be appended by the caller.
+         */
+        template<StructuredFormat format, typename T>
+        void AppendField(std::string& out, const std::string_view& key, const T& value)
+        {
+            if constexpr(format == StructuredFormat::JSON)
+            {
+                out.push_back(',');
+                AppendJSONString(out, key);
+                out.push_back(':');
+            }
+            else
+            {
+                out.push_back(' ');
+                out.append(key);
+                out.push_back('=');
+            }
+
+            AppendValue<format>(out, value);
+        }
+
+        template<StructuredFormat format, typename Key, typename Value, typename... Fields>
+        void AppendFields(std::string& out, const Key& key, const Value& value, const Fields&... fields)
+        {
+            static_assert(Concepts::StringLike<Key, char>, "GE_LOG_KV: every key must be a string");
+
+            AppendField<format>(out, std::string_view{ key }, value);
+
+            if constexpr(sizeof...(Fields) != 0)
+                AppendFields<format>(out, fields...);
+        }
+    }
+}
+
+//logging context, is used by GE_LOG_SCOPE_FIELD
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Per-thread fields added to every line of the thread without passing them to each call(MDC): "key=value" after the prefix of GE_LOG lines,
+     * extra fields of GE_LOG_KV lines. A field is rendered once, when it is added, so a line only copies the rendered text.
+     * Capture and Restore carry the fields to another thread(a task of a thread pool, a resumed coroutine).
+     */
+    class LogContext final
+    {
+    public:
+        //of every rendered form, a field, which doesn't fit, is ignored
+        static constexpr size_t capacity = 256;
+
+        /**
+         * \brief Rendered fields of a thread, a copy is made by Capture.
+         */
+        struct Snapshot final
+        {
+            //" key=value" for every field
+            std::array<char, capacity> logfmt;
+            //",\"key\":value" for every field
+            std::array<char, capacity> json;
+            uint16_t logfmtSize;
+            uint16_t jsonSize;
+        };
+
+        /**
+         * \brief Adds the field to the thread's context until its destruction. Use GE_LOG_SCOPE_FIELD instead.
+         * Fields are removed in the reverse order, so it must not outlive the scope it was created in.
+         */
+        class Field final
+        {
+        public:
+            template<typename Value>
+            Field(const std::string_view& key, const Value& value)
+                : logfmtSize(current.logfmtSize), jsonSize(current.jsonSize)
+            {
+                Formatting::ThreadLocalBuffer<char> buffer;
+                std::string& rendered = buffer.Get();
+
+                Structured::AppendField<StructuredFormat::Logfmt>(rendered, key, value);
+                const size_t logfmtLength = rendered.size();
+                Structured::AppendField<StructuredFormat::JSON>(rendered, key, value);
+                const size_t jsonLength = rendered.size() - logfmtLength;
+
+                if(logfmtSize + logfmtLength > capacity || jsonSize + jsonLength > capacity)
+                    return;
+
+                std::memcpy(current.logfmt.data() + logfmtSize, rendered.data(), logfmtLength);
+                std::memcpy(current.json.data() + jsonSize, rendered.data() + logfmtLength, jsonLength);
+
+                current.logfmtSize = static_cast<uint16_t>(logfmtSize + logfmtLength);
+                current.jsonSize = static_cast<uint16_t>(jsonSize + jsonLength);
+            }
+            ~Field()
+            {
+                current.logfmtSize = logfmtSize;
+                current.jsonSize = jsonSize;
+            }
+
+            Field(const Field&) = delete;
+            Field& operator=(const Field&) = delete;
+
+        private:
+            uint16_t logfmtSize;
+            uint16_t jsonSize;
+        };
+
+        /**
+         * \brief Replaces the thread's context with the captured one until its destruction, then puts the previous one back.
+         * A coroutine, which is resumed on another thread, must restore its context before its fields are destroyed there.
+         */
+        class Restore final
+        {
+        public:
+            explicit Restore(const Snapshot& snapshot)
+                : previous(current)
+            {
+                current = snapshot;
+            }
+            ~Restore()
+            {
+                current = previous;
+            }
+
+            Restore(const Restore&) = delete;
+            Restore& operator=(const Restore&) = delete;
+
+        private:
+            Snapshot previous;
+        };
+
+    public:
+        LogContext() = delete;
+        ~LogContext() = delete;
+
+        /**
+         * \return Copy of the thread's fields, which can be restored on any thread.
+         */
+        [[nodiscard]]
+        static Snapshot Capture()
+        {
+            return current;
+        }
+
+        /**
+         * \return " key=value" for every field of the thread, empty if there are no fields.
+         */
+        [[nodiscard]]
+        static std::string_view GetLogfmt()
+        {
+            return { current.logfmt.data(), current.logfmtSize };
+        }
+        /**
+         * \return ",\"key\":value" for every field of the thread, empty if there are no fields.
+         */
+        [[nodiscard]]
+        static std::string_view GetJSON()
+        {
+            return { current.json.data(), current.jsonSize };
+        }
+
+    private:
+        //constant-initialized, so access doesn't need a guard
+        static inline thread_local constinit Snapshot current{};
+    };
+}
+
+//colors stuff
+namespace GuelderConsoleLog
+{
+    template<Concepts::ConsoleColorAttributes Rhs, Concepts::ConsoleColorAttributes Lhs>
+    constexpr uint16_t operator|(Rhs&& lhs, Lhs&& rhs)
+    {
+        return static_cast<std::underlying_type_t<ConsoleForegroundColor>>(lhs) | static_cast<std::underlying_type_t<ConsoleForegroundColor>>(rhs);
+    }
+
+    /**
+     * \brief Struct, which is used to set colors of a log message
+     * \tparam _categoryColor The color, which is used with logging category name.
+     * \tparam _messageColor The color, which is used with the actual message.
+     */
+    template<uint16_t _categoryColor, uint16_t _messageColor>
+    struct LoggingLevelsCategoryColor final
+    {
+        static constexpr uint16_t categoryColor = _categoryColor;
+        static constexpr uint16_t messageColor = _messageColor;
+    };
+
+    /**
+     * \brief Struct, which represents a set of LoggingLevelsCategoryColor for Info, Warning and Error logging categories.
+     */
+    template<LoggingLevelsCategoryColor _info, LoggingLevelsCategoryColor _warning, LoggingLevelsCategoryColor _error>
+    struct LoggingLevelsCategoryColors final
+    {
+        static constexpr LoggingLevelsCategoryColor info = _info;
+        static constexpr LoggingLevelsCategoryColor warning = _warning;
+        static constexpr LoggingLevelsCategoryColor error = _error;
+    };
+
+    //aliases
+    namespace Colors
+    {
+        using Background = ConsoleBackgroundColor;
+        using Text = ConsoleForegroundColor;
+
+        template<uint16_t _categoryColor, uint16_t _messageColor>
+        using CategoryColor = LoggingLevelsCategoryColor<_categoryColor, _messageColor>;
+
+        template<CategoryColor _info, CategoryColor _warning, CategoryColor _error>
+        using CategoryColors = LoggingLevelsCategoryColors<_info, _warning, _error>;
+    }
+}
+
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Bit flags, so a category can support any set of levels(e.g. Warning | LogLevel::Error). Higher bits are more severe.
+     */
+    enum class LogLevel : uint8_t
+    {
+        Trace = 1 << 0,
+        Debug = 1 << 1,
+        Info = 1 << 2,
+        Warning = 1 << 3,
+        Error = 1 << 4,
+        All = Trace | Debug | Info | Warning | Error
+    };
+
+    constexpr LogLevel operator|(const LogLevel& lhs, const LogLevel& rhs)
+    {
+        return static_cast<LogLevel>(static_cast<std::underlying_type_t<LogLevel>>(lhs) | static_cast<std::underlying_type_t<LogLevel>>(rhs));
+    }
+    constexpr LogLevel operator&(const LogLevel& lhs, const LogLevel& rhs)
+    {
+        return static_cast<LogLevel>(static_cast<std::underlying_type_t<LogLevel>>(lhs) & static_cast<std::underlying_type_t<LogLevel>>(rhs));
+    }
+
+    /**
+     * \brief GE_LOG calls with a lower level are compiled out, see GE_MIN_LOG_LEVEL.
+     */
+    constexpr LogLevel minLogLevel = LogLevel::GE_MIN_LOG_LEVEL;
+
+    /**
+     * \return "[TRACE]", "[DEBUG]", "[INFO]", "[WARNING]" or "[ERROR]", empty string for other values.
+     */
+    [[nodiscard]]
+    constexpr std::string_view GetLogLevelTag(const LogLevel& level)
+    {
+        switch(level)
+        {
+        case LogLevel::Trace:
+            return "[TRACE]";
+        case LogLevel::Debug:
+            return "[DEBUG]";
+        case LogLevel::Info:
+            return "[INFO]";
+        case LogLevel::Warning:
+            return "[WARNING]";
+        case LogLevel::Error:
+            return "[ERROR]";
+        default:
+            return {};
+        }
+    }
+
+    //defined in GuelderConsoleLogSinks.hpp
+    class Sink;
+
+    /**
+     * \brief Runtime part of a logging category, one object per category type. Everything inside, except minLevel, is guarded by Logger's mutex.
+     */
+    struct CategoryState final
+    {
+        constexpr CategoryState(const std::string_view& name)
+            : name(name) {}
+
+        std::string_view name;
+        //if empty, Logger's default sinks are used
+        std::vector<std::shared_ptr<Sink>> sinks;
+        //underlying value of the lowest LogLevel, which is written, is read by GE_LOG before the arguments are evaluated
+        std::atomic<uint8_t> minLevel = 0;
+        //underlying value of the lowest LogLevel, which is written while LoadShedding sheds the category, 0 if it doesn't
+        std::atomic<uint8_t> shedLevel = 0;
+        //lowest levels written under Backpressure::Elevated and Backpressure::High(GE_DECLARE_LOG_SHEDDING_POLICY), 0 - the category is never shed
+        uint8_t sheddingPolicy[2] = {};
+        //how GE_LOG_KV writes lines of the category
+        std::atomic<StructuredFormat> structuredFormat = StructuredFormat::JSON;
+        //count of the last lines of every thread kept by FlightRecorder, 0 if it is off
+        std::atomic<uint32_t> flightRecorderSize = 0;
+        //index of the category in Metrics, is set when the category is registered, 0 - not registered
+        std::atomic<uint32_t> metricsId = 0;
+        //records dropped by LoadShedding since its last summary, indexed by the bit of LogLevel,
+        //on their own cache line, so counting them doesn't slow down reading minLevel
+        alignas(64) std::atomic<uint64_t> shedCounts[5] = {};
+    };
+
+    /**
+     * \brief Is constant-initialized, so it can be used at any moment of static initialization.
+     * \tparam Category Type created by GE_DECLARE_LOG_CATEGORY_CONSTEXPR.
+     */
+    template<typename Category>
+    constinit inline CategoryState categoryState{ Category::GetName() };
+
+    /**
+     * \brief Keeps the last lines of categories in per-thread rings, including the lines below their runtime levels(GE_SET_LOG_LEVEL),
+     * and writes them in chronological order to the standard error, when Logger::Throw or Logger::Assert fails or the process gets SIGSEGV, SIGABRT, SIGBUS, SIGFPE or SIGILL.
+     */
+    class FlightRecorder final
+    {
+    public:
+        //longer lines are cut
+        static constexpr size_t maxLineSize = 256;
+
+    public:
+        FlightRecorder() = delete;
+        ~FlightRecorder() = delete;
+
+        /**
+         * \brief Every thread keeps the last recordsCount lines of the category, 0 turns it off.
+         * The first call with recordsCount != 0 installs the signal handlers. Use GE_SET_LOG_FLIGHT_RECORDER instead.
+         */
+        template<typename Category>
+            requires requires { Category::enable; }
+        static void SetSize(const Category&, const uint32_t& recordsCount)
+        {
+            if constexpr(Category::enable)
+                SetSize(categoryState<Category>, recordsCount);
+        }
+        static void SetSize(CategoryState& category, const uint32_t& recordsCount);
+
+        /**
+         * \brief Writes every kept line(without colors) to the file descriptor in chronological order and forgets them. Is async-signal-safe.
+         */
+        static void Dump(const int& fileDescriptor = 2);
+
+        [[nodiscard]]
+        static bool IsEnabled(const CategoryState& category)
+        {
+            return category.flightRecorderSize.load(std::memory_order_relaxed) != 0;
+        }
+        /**
+         * \brief Copies the line into the thread's ring of the category, if the category has one.
+         */
+        static void Record(CategoryState& category, const std::string_view& line, const std::chrono::system_clock::time_point& time)
+        {
+            const uint32_t recordsCount = category.flightRecorderSize.load(std::memory_order_relaxed);
+
+            if(recordsCount != 0)
+                RecordToThreadRing(category, recordsCount, line, time);
+        }
+
+    private:
+        //defined in GuelderConsoleLog.cpp
+        struct Ring;
+
+    private:
+        //every ring ever created, new ones are pushed to the front
+        static std::atomic<Ring*> rings;
+
+    private:
+        static void RecordToThreadRing(CategoryState& category, const uint32_t& recordsCount, const std::string_view& line, const std::chrono::system_clock::time_point& time);
+        /**
+         * \brief Is called by Logger::Throw.
+         */
+        static void DumpIfEnabled();
+
+        friend class Logger;
+    };
+
+    /**
+     * \brief Durations in nanoseconds: bucket i counts values up to 64 << i, the last one counts all the rest.
+     */
+    struct LatencyHistogram final
+    {
+        static constexpr size_t bucketsCount = 24;
+
+        std::array<uint64_t, bucketsCount> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        [[nodiscard]]
+        static constexpr uint64_t GetBucketBound(const size_t& index)
+        {
+            return uint64_t{ 64 } << index;
+        }
+    };
+
     /**
-     * \brief WARNING: This func only works properly with windows, because I don't give a fuck about Linux or MacOS.
+     * \brief Everything Metrics has counted since it was enabled.
      */
-    inline std::string WStringToString(const std::wstring_view& wStr)
+    struct MetricsSnapshot final
     {
-#ifdef WIN32
-        const int neededSize = WideCharToMultiByte(CP_UTF8, 0, wStr.data(), wStr.size(), nullptr, 0, nullptr, nullptr);
-        std::string string(neededSize, L'\0');
-        WideCharToMultiByte(CP_UTF8, 0, wStr.data(), wStr.size(), string.data(), neededSize, nullptr, nullptr);
-#else
-        std::string string;
-#endif
+        struct Category final
+        {
+            std::string_view name;
+            //indexed by the bit of LogLevel: Trace, Debug, Info, Warning, Error
+            std::array<uint64_t, 5> records{};
+            std::array<uint64_t, 5> bytes{};
+            //by GE_LOG_EVERY_N, GE_LOG_ONCE, GE_LOG_EVERY_MS and GE_LOG_RATE_LIMITED
+            uint64_t suppressed = 0;
+        };
 
-        return string;
-    }
-}
+        std::vector<Category> categories;
 
-//concepts
-namespace GuelderConsoleLog
-{
-    template<typename T>
-    using RawType = std::remove_cv_t<std::remove_reference_t<std::remove_pointer_t<std::remove_extent_t<T>>>>;
+        //from the end of formatting till Logger::logMutex is locked
+        LatencyHistogram lockWait;
+        //from the beginning of Log till the line is handed to the output
+        LatencyHistogram format;
+        //how long the sinks take
+        LatencyHistogram write;
 
-    namespace Concepts
+        bool async = false;
+        uint64_t asyncQueueDepth = 0;
+        uint64_t asyncQueueCapacity = 0;
+        uint64_t asyncDroppedCount = 0;
+    };
+
+    /**
+     * \brief Logger's own counters and latency histograms. Every thread counts into its own shard without locked instructions, GetSnapshot merges them.
+     * Is off by default, then it costs one relaxed load per record.
+     */
+    class Metrics final
     {
-        template<typename T, typename U>
-        concept SameRawType = std::is_same_v<RawType<T>, RawType<U>>;
+    public:
+        Metrics() = delete;
+        ~Metrics() = delete;
 
-        template<typename... Args>               //idk why RawType<Args>, because the same thing is made inside SameRawType, C++ blows my mind
-        concept IsThereAtLeastOneWideChar = (SameRawType<typename RawType<Args>::value_type, wchar_t> || ...) || (SameRawType<RawType<Args>, wchar_t> || ...);
+        static void SetEnabled(const bool& enabled);
+        [[nodiscard]]
+        static bool IsEnabled()
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
 
-        template<typename String, typename... Strings>
-        concept IsAtLeastOneSameRaw = (SameRawType<RawType<String>, Strings> || ...);
+        [[nodiscard]]
+        static MetricsSnapshot GetSnapshot();
 
-        template<typename Char, typename T>
-        concept HasOutputOperator = (requires(std::basic_ostream<Char>&os, const T & t) { os << t; });
+        /**
+         * \brief Prometheus text exposition format, every metric is prefixed with "guelder_console_log_".
+         */
+        [[nodiscard]]
+        static std::string FormatPrometheus(const MetricsSnapshot& snapshot);
+        /**
+         * \brief Writes the current snapshot in Prometheus format to a temporary file and renames it to path, so a reader(e.g. node_exporter's textfile collector) never sees a partial file.
+         * \return false if the file couldn't be written.
+         */
+        static bool ExportPrometheus(const std::filesystem::path& path);
+        static void ExportPrometheus(const std::function<void(const std::string_view& text)>& callback);
 
-        template<typename T>
-        concept STDCout = HasOutputOperator<char, T>;
+        /**
+         * \brief Is called by the rate limiting macros with the count of messages suppressed before the written one.
+         */
+        template<typename Category>
+        static void AddSuppressed(const Category&, const uint64_t& count)
+        {
+            if constexpr(Category::enable)
+            {
+                if(count != 0 && IsEnabled())
+                    AddSuppressed(categoryState<Category>, count);
+            }
+        }
 
-        template<typename T>
-        concept STDWout = HasOutputOperator<wchar_t, T> && !STDCout<T>;
+    private:
+        //defined in GuelderConsoleLog.cpp
+        struct Shard;
 
-        template<typename T>
-        concept STDOut = STDCout<T> || STDWout<T>;
+    private:
+        static std::atomic<bool> enabled;
+        //every shard ever created, new ones are pushed to the front
+        static std::atomic<Shard*> shards;
 
-        template<typename... Attributes>
-        concept ConsoleColorAttributes = (std::is_same_v<RawType<Attributes>, ConsoleForegroundColor> || ...) || (std::is_same_v<RawType<Attributes>, ConsoleBackgroundColor> || ...) || (std::is_same_v<RawType<Attributes>, uint16_t> || ...);
+    private:
+        static Shard& GetThreadShard();
 
-        template<typename T>
-        concept IsException = (std::is_same_v<T, std::exception> || std::is_base_of_v<std::exception, T>) && (std::is_constructible_v<T, const std::string&> || std::is_constructible_v<T, const char*>);
-    }
-}
+        static void AddSuppressed(const CategoryState& category, const uint64_t& count);
 
-//colors stuff
-namespace GuelderConsoleLog
-{
-    template<Concepts::ConsoleColorAttributes Rhs, Concepts::ConsoleColorAttributes Lhs>
-    constexpr uint16_t operator|(Rhs&& lhs, Lhs&& rhs)
-    {
-        return static_cast<std::underlying_type_t<ConsoleForegroundColor>>(lhs) | static_cast<std::underlying_type_t<ConsoleForegroundColor>>(rhs);
-    }
+        static void AddRecord(const CategoryState* category, const LogLevel& level, const size_t& bytes);
+        static void AddLockWait(const std::chrono::nanoseconds& duration);
+        static void AddFormat(const std::chrono::nanoseconds& duration);
+        static void AddWrite(const std::chrono::nanoseconds& duration);
 
-    /**
-     * \brief Struct, which is used to set colors of a log message
-     * \tparam _categoryColor The color, which is used with logging category name.
-     * \tparam _messageColor The color, which is used with the actual message.
-     */
-    template<uint16_t _categoryColor, uint16_t _messageColor>
-    struct LoggingLevelsCategoryColor final
+        friend class Logger;
+    };
+
+    enum class Backpressure : uint8_t
     {
-        static constexpr uint16_t categoryColor = _categoryColor;
-        static constexpr uint16_t messageColor = _messageColor;
+        None,
+        //the sinks fall behind, categories with a shedding policy lose their lowest levels
+        Elevated,
+        High
     };
 
     /**
-     * \brief Struct, which represents a set of LoggingLevelsCategoryColor for Info, Warning and Error logging categories.
+     * \brief Drops lower levels of categories with a shedding policy(GE_DECLARE_LOG_SHEDDING_POLICY) while the output can't keep up:
+     * logging threads wait for Logger's mutex too long or the queue of the asynchronous mode fills up. Error is never dropped.
+     * When the pressure clears, one line with the counts of dropped records is written through the default sinks.
+     * Costs nothing until a policy is declared.
      */
-    template<LoggingLevelsCategoryColor _info, LoggingLevelsCategoryColor _warning, LoggingLevelsCategoryColor _error>
-    struct LoggingLevelsCategoryColors final
+    class LoadShedding final
     {
-        static constexpr LoggingLevelsCategoryColor info = _info;
-        static constexpr LoggingLevelsCategoryColor warning = _warning;
-        static constexpr LoggingLevelsCategoryColor error = _error;
-    };
+    public:
+        struct Options final
+        {
+            //the pressure is measured over windows of this length
+            std::chrono::milliseconds window{ 100 };
+            //mean wait for Logger's mutex per record in a window
+            std::chrono::microseconds elevatedLockWait{ 100 };
+            std::chrono::microseconds highLockWait{ 1000 };
+            //the highest fill of the async queue in a window, from 0 to 1
+            double elevatedQueueFill = 0.5;
+            double highQueueFill = 0.9;
+            //the pressure goes down only after it has been lower for this long
+            std::chrono::milliseconds coolDown{ 2000 };
+        };
 
-    //aliases
-    namespace Colors
-    {
-        using Background = ConsoleBackgroundColor;
-        using Text = ConsoleForegroundColor;
+    public:
+        LoadShedding() = delete;
+        ~LoadShedding() = delete;
 
-        template<uint16_t _categoryColor, uint16_t _messageColor>
-        using CategoryColor = LoggingLevelsCategoryColor<_categoryColor, _messageColor>;
+        /**
+         * \brief Use GE_DECLARE_LOG_SHEDDING_POLICY instead.
+         * \param elevatedMinLevel Lowest level written under Backpressure::Elevated.
+         * \param highMinLevel Lowest level written under Backpressure::High.
+         * \return true, so it can initialize a variable.
+         */
+        template<typename Category>
+            requires requires { Category::enable; }
+        static bool SetPolicy(const Category&, const LogLevel& elevatedMinLevel, const LogLevel& highMinLevel)
+        {
+            if constexpr(Category::enable)
+                SetPolicy(categoryState<Category>, elevatedMinLevel, highMinLevel);
 
-        template<CategoryColor _info, CategoryColor _warning, CategoryColor _error>
-        using CategoryColors = LoggingLevelsCategoryColors<_info, _warning, _error>;
-    }
-}
+            return true;
+        }
 
-namespace GuelderConsoleLog
-{
-    enum class LogLevel : uint8_t
+        static void SetOptions(const Options& options);
+        [[nodiscard]]
+        static Backpressure GetBackpressure();
+
+        [[nodiscard]]
+        static bool IsEnabled()
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static std::atomic<bool> enabled;
+        static std::atomic<Backpressure> backpressure;
+
+    private:
+        static void SetPolicy(CategoryState& category, const LogLevel& elevatedMinLevel, const LogLevel& highMinLevel);
+
+        /**
+         * \brief Counts a record dropped by IsLogLevelEnabled. Nothing may reach Logger's mutex while everything is shed, so it also measures the pressure sometimes(never on a writer thread, see Logger::WriterScope).
+         */
+        GE_COLD static void CountShed(CategoryState& category, const LogLevel& level);
+
+        //Logger's mutex must be locked
+        static void AddLockSample(const std::chrono::system_clock::time_point& time, const std::chrono::nanoseconds& lockWait);
+        static void AddQueueSample(const std::chrono::system_clock::time_point& time, const double& queueFill);
+        /**
+         * \brief Closes the window if it has passed and changes the pressure if needed. Logger's mutex must be locked.
+         */
+        static void Evaluate(const std::chrono::system_clock::time_point& time);
+        /**
+         * \brief Writes the counts of shed records through the default sinks and resets them. Logger's mutex must be locked.
+         */
+        static void WriteSummary(const std::chrono::system_clock::time_point& time, const std::chrono::system_clock::duration& duration);
+
+        friend class Logger;
+    };
+
+    /**
+     * \brief One written line and what it was made from. Views are valid only during Sink::Write.
+     */
+    struct LogRecord final
     {
-        Info,
-        Warning,
-        Error,
-        All = Info | Warning | Error
+        //the whole line including the time, colors and '\n'
+        std::string_view line;
+        std::string_view categoryName;
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time;
+        //nullptr if the category wasn't declared with GE_DECLARE_LOG_CATEGORY_CONSTEXPR
+        CategoryState* category = nullptr;
+        //the line contains ANSI color sequences(the standard output is a terminal), sinks, which don't write to it, should strip them
+        bool colored = false;
+        //when making the line began, is set only while Metrics is enabled
+        std::chrono::steady_clock::time_point formatBegin{};
     };
 
     template<LogLevel loggingLevels, bool _enable, bool _writeTime, Colors::CategoryColors _levelsColors>
@@ -191,9 +1411,11 @@ namespace GuelderConsoleLog
     template<LogLevel loggingLevels, bool _writeTime, Colors::CategoryColors _levelsColors>
     struct LoggingCategory<loggingLevels, false, _writeTime, _levelsColors>
     {
-        constexpr LoggingCategory(const std::string_view& name) {}
+        constexpr LoggingCategory(const std::string_view& name, CategoryState* = nullptr)
+            : name(name) {}
 
         static constexpr LogLevel supportedLoggingLevels = loggingLevels;
+        std::string_view name;
         static constexpr bool enable = false;
         static constexpr bool writeTime = _writeTime;
 
@@ -203,40 +1425,92 @@ namespace GuelderConsoleLog
     template<LogLevel loggingLevels, bool _writeTime, Colors::CategoryColors _levelsColors>
     struct LoggingCategory<loggingLevels, true, _writeTime, _levelsColors>
     {
-        constexpr LoggingCategory(const std::string_view& name)
-            : name(name) {}
-        virtual ~LoggingCategory() = default;
+        constexpr LoggingCategory(const std::string_view& name, CategoryState* state = nullptr)
+            : name(name), state(state) {}
 
         [[nodiscard]]
         static constexpr bool CanSupportLogLevel(const LogLevel& level)
         {
-            if(supportedLoggingLevels == LogLevel::All)
-                return true;
-            return static_cast<std::underlying_type_t<LogLevel>>(level) &
-                static_cast<std::underlying_type_t<LogLevel>>(supportedLoggingLevels);
+            return (level & supportedLoggingLevels) == level;
         }
 
         static constexpr LogLevel supportedLoggingLevels = loggingLevels;
         std::string_view name;
+        CategoryState* state;
         static constexpr bool enable = true;
         static constexpr bool writeTime = _writeTime;
 
         static constexpr Colors::CategoryColors levelsColors = _levelsColors;
     };
 
+    /**
+     * \brief How many digits of a second are written after "HH:MM:SS".
+     */
+    enum class TimestampPrecision : uint8_t
+    {
+        Seconds,
+        Milliseconds,
+        Microseconds,
+        Nanoseconds
+    };
+
+    enum class TimestampZone : uint8_t
+    {
+        Local,
+        //skips the time zone conversion entirely
+        UTC
+    };
+
+    /**
+     * \brief What Logger does with a message, when the queue of the asynchronous mode is full.
+     */
+    enum class AsyncOverflowPolicy : uint8_t
+    {
+        //the logging thread waits until the writing thread frees a place
+        Block,
+        //the message is thrown away and counted in Logger::GetAsyncDroppedCount
+        Drop
+    };
+
     class Logger final
     {
     public:
         Logger() = delete;
         ~Logger() = delete;
 
+        /**
+         * \brief The line prefix("Core: [INFO]: " with colors) is made at compile time, if Category is a type created by GE_DECLARE_LOG_CATEGORY_CONSTEXPR.
+         * Nothing is instantiated if level is below GE_MIN_LOG_LEVEL.
+         */
+        template<LogLevel level, typename Category, Concepts::STDOut... Args>
+        constexpr static void Log(const Category& category, Args&&... args)
+        {
+            if constexpr(Category::enable && level >= minLogLevel)
+                WriteLog<level>(category, std::forward<Args>(args)...);
+        }
         template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime, Concepts::STDOut... Args>
         constexpr static void Log(const LoggingCategory<loggingLevels, true, writeTime, _levelsColors>& category, const LogLevel& level, Args&&... args)
         {
-            if constexpr(Concepts::IsThereAtLeastOneWideChar<Args...>)
-                WriteLog<wchar_t, loggingLevels, writeTime, _levelsColors>(category, level, Format(std::forward<Args>(args)...));
-            else
-                WriteLog<char, loggingLevels, writeTime, _levelsColors>(category, level, Format(std::forward<Args>(args)...));
+            switch(level)
+            {
+            case LogLevel::Trace:
+                Log<LogLevel::Trace>(category, std::forward<Args>(args)...);
+                break;
+            case LogLevel::Debug:
+                Log<LogLevel::Debug>(category, std::forward<Args>(args)...);
+                break;
+            case LogLevel::Info:
+                Log<LogLevel::Info>(category, std::forward<Args>(args)...);
+                break;
+            case LogLevel::Warning:
+                Log<LogLevel::Warning>(category, std::forward<Args>(args)...);
+                break;
+            case LogLevel::Error:
+                Log<LogLevel::Error>(category, std::forward<Args>(args)...);
+                break;
+            default:
+                Throw(Format("Logger::Log: invalid logging level for \"", category.name, '"'), __FILE__, __LINE__);
+            }
         }
         /// <summary>
         /// disabled if enable == false
@@ -244,31 +1518,260 @@ namespace GuelderConsoleLog
         template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime, Concepts::STDOut... Args>
         constexpr static void Log(const LoggingCategory<loggingLevels, false, writeTime, _levelsColors>& category, const LogLevel& level, Args&&... args) {}
 
-        template<Concepts::IsException Exception = std::exception>
+        /**
+         * \brief Checked by GE_LOG before the arguments are evaluated: relaxed loads of the category's minimal level and its LoadShedding level.
+         * Is also true below them, if the category has a FlightRecorder.
+         */
+        template<LogLevel level, typename Category>
+        [[nodiscard]]
+        static bool IsLogLevelEnabled(const Category&)
+        {
+            if constexpr(!Category::enable || level < minLogLevel)
+                return false;
+            else
+            {
+                //instantiating it is enough to register the category during static initialization
+                static_cast<void>(&categoryRegistered<Category>);
+
+                auto& state = categoryState<Category>;
+
+                if(static_cast<uint8_t>(level) >= state.minLevel.load(std::memory_order_relaxed))
+                {
+                    if(static_cast<uint8_t>(level) >= state.shedLevel.load(std::memory_order_relaxed)) [[likely]]
+                        return true;
+
+                    LoadShedding::CountShed(state, level);
+                }
+
+                //lines below the level are still made for FlightRecorder
+                return FlightRecorder::IsEnabled(state);
+            }
+        }
+
+        /**
+         * \brief Is checked by the rate limited macros after IsLogLevelEnabled: false if the line would be made only for FlightRecorder,
+         * such lines don't take passes of the rate limiter.
+         */
+        template<LogLevel level, typename Category>
+        [[nodiscard]]
+        static bool IsLogLevelWritten(const Category&)
+        {
+            if constexpr(!Category::enable || level < minLogLevel)
+                return false;
+            else
+                return IsWritten(&categoryState<Category>, level);
+        }
+
+        /**
+         * \brief Writes one structured line: time(if writeTime), category, level, "msg" and the fields in the category's StructuredFormat.
+         * Use GE_LOG_KV instead.
+         * \param fields Pairs of a string key and a value.
+         */
+        template<LogLevel level, typename Category, typename Message, typename... Fields>
+        static void LogStructured(const Category& category, const Message& message, const Fields&... fields)
+        {
+            static_assert(sizeof(Message) != 0 && sizeof...(Fields) % 2 == 0, "GE_LOG_KV: fields must be pairs of a key and a value");
+
+            if constexpr(Category::enable && level >= minLogLevel)
+            {
+                if constexpr(!Category::CanSupportLogLevel(level))
+                    Throw(Format("Logger::LogStructured: invalid logging level or \"", category.name, "\" doesn't support any logging level"), __FILE__, __LINE__);
+                else
+                {
+                    const StructuredFormat format = category.state ? category.state->structuredFormat.load(std::memory_order_relaxed) : StructuredFormat::JSON;
+
+                    if(format == StructuredFormat::JSON)
+                        WriteStructured<StructuredFormat::JSON, level, Category::writeTime>(category, message, fields...);
+                    else
+                        WriteStructured<StructuredFormat::Logfmt, level, Category::writeTime>(category, message, fields...);
+                }
+            }
+        }
+        /**
+         * \brief Use GE_SET_LOG_STRUCTURED_FORMAT instead.
+         */
+        template<typename Category>
+            requires requires { Category::enable; }
+        static void SetStructuredFormat(const Category&, const StructuredFormat& format)
+        {
+            if constexpr(Category::enable)
+                categoryState<Category>.structuredFormat.store(format, std::memory_order_relaxed);
+        }
+
+        /**
+         * \brief Messages of the category below minLevel are skipped without evaluating their arguments. Can be called at any moment from any thread.
+         * Use GE_SET_LOG_LEVEL instead.
+         */
+        template<typename Category>
+            requires requires { Category::enable; }
+        static void SetLogLevel(const Category&, const LogLevel& minLevel)
+        {
+            if constexpr(Category::enable)
+                categoryState<Category>.minLevel.store(static_cast<uint8_t>(minLevel), std::memory_order_relaxed);
+        }
+        /**
+         * \brief Same as SetLogLevel, but for every declared category with the name(e.g. from a config file).
+         * If there is no such category yet, the level is applied when it is registered.
+         */
+        static void SetLogLevel(const std::string_view& categoryName, const LogLevel& minLevel);
+        /**
+         * \brief Sets the level of every declared category and forgets the levels, which were set by name.
+         */
+        static void SetAllLogLevels(const LogLevel& minLevel);
+        template<typename Category>
+        [[nodiscard]]
+        static LogLevel GetLogLevel(const Category& category)
+        {
+            return static_cast<LogLevel>(categoryState<Category>.minLevel.load(std::memory_order_relaxed));
+        }
+        /**
+         * \return Names of all the categories, which are registered now.
+         */
+        [[nodiscard]]
+        static std::vector<std::string_view> GetCategoryNames();
+
+        /**
+         * \brief Switches Logger to the asynchronous mode: Log only pushes a formatted record into a bounded lock-free queue and returns,
+         * a dedicated thread writes records to the output. Does nothing if the asynchronous mode is already on.
+         * \param queueCapacity Max count of records inside the queue, is rounded up to a power of two.
+         * Only the first call makes the queue, later calls after StopAsync reuse it with its capacity.
+         * \param overflowPolicy What to do with a record, when the queue is full.
+         */
+        static void StartAsync(const size_t& queueCapacity = 8192, const AsyncOverflowPolicy& overflowPolicy = AsyncOverflowPolicy::Block);
+        /**
+         * \brief Writes all the records left in the queue and stops the writing thread. Is called automatically at exit.
+         * WARNING: must not be called concurrently with StartAsync.
+         */
+        static void StopAsync();
+        /**
+         * \brief Blocks until every record, which was logged before this call, is written and flushes all the sinks.
+         */
+        static void Flush();
+
+        /**
+         * \brief While it exists, Throw on this thread doesn't call Flush, which would wait for the thread itself, and LoadShedding doesn't try to lock logMutex:
+         * is made while logMutex is held(inside sinks) and by the threads, which write for sinks(e.g. the writer of FileSink).
+         */
+        class WriterScope final
+        {
+        public:
+            WriterScope()
+                : previous(isWriterThread)
+            {
+                isWriterThread = true;
+            }
+            ~WriterScope()
+            {
+                isWriterThread = previous;
+            }
+
+            WriterScope(const WriterScope&) = delete;
+            WriterScope& operator=(const WriterScope&) = delete;
+
+        private:
+            bool previous;
+        };
+
+        /**
+         * \brief Routes the category to the sink in addition to its other sinks, the category stops using the default ones.
+         * Use GE_ADD_LOG_SINK instead.
+         */
+        template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime>
+        static void AddSink(const LoggingCategory<loggingLevels, true, writeTime, _levelsColors>& category, const std::shared_ptr<Sink>& sink)
+        {
+            AddSink(category.state, sink);
+        }
+        template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime>
+        static void AddSink(const LoggingCategory<loggingLevels, false, writeTime, _levelsColors>&, const std::shared_ptr<Sink>&) {}
+        /**
+         * \brief The category goes back to the default sinks.
+         */
+        template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime>
+        static void RemoveSinks(const LoggingCategory<loggingLevels, true, writeTime, _levelsColors>& category)
+        {
+            RemoveSinks(category.state);
+        }
+        template<LogLevel loggingLevels, Colors::CategoryColors _levelsColors, bool writeTime>
+        static void RemoveSinks(const LoggingCategory<loggingLevels, false, writeTime, _levelsColors>&) {}
+
+        /**
+         * \brief Default sinks are used by categories without their own ones. Initially it is one ConsoleSink.
+         */
+        static void SetDefaultSinks(const std::vector<std::shared_ptr<Sink>>& sinks);
+        static void AddDefaultSink(const std::shared_ptr<Sink>& sink);
+
+        /**
+         * \brief Sets how the time is written by categories with writeTime == true. Default is Seconds and Local.
+         */
+        static void SetTimestampFormat(const TimestampPrecision& precision, const TimestampZone& zone = TimestampZone::Local);
+        [[nodiscard]]
+        static TimestampPrecision GetTimestampPrecision();
+        [[nodiscard]]
+        static TimestampZone GetTimestampZone();
+
+        [[nodiscard]]
+        static bool IsAsync();
+        /**
+         * \return Count of records, which were thrown away because of AsyncOverflowPolicy::Drop.
+         */
+        [[nodiscard]]
+        static uint64_t GetAsyncDroppedCount();
+
+        template<Concepts::IsException Exception = DefaultException>
         [[noreturn]]
         static void Throw(const std::string_view& message, const char* const fileName, const uint32_t& line)
         {
+            if(!isWriterThread)
+                Flush();
+            FlightRecorder::DumpIfEnabled();
             throw Exception(Format(message, '\n', "file: ", fileName, ", line: ", line).c_str());
         }
 
-        template<Concepts::IsException Exception = std::exception>
+        template<Concepts::IsException Exception = DefaultException>
         [[noreturn]]
         static void Throw(const std::string_view& message)
         {
+            if(!isWriterThread)
+                Flush();
+            FlightRecorder::DumpIfEnabled();
             throw Exception(message.data());
         }
 
-        template<typename Exception = std::exception>
+        template<typename Exception = DefaultException>
         [[noreturn]]
         static void Throw(Exception&& exception)
         {
+            if(!isWriterThread)
+                Flush();
+            FlightRecorder::DumpIfEnabled();
             throw exception;
         }
 
+        /**
+         * \brief Is used by GE_THROW and GE_ASSERT: makeMessage is called only here, so the message isn't built in the caller's code.
+         * \param makeMessage Returns std::string or std::wstring(is converted to UTF-8).
+         */
+        template<Concepts::IsException Exception = DefaultException, typename MessageMaker>
+        [[noreturn]]
+        GE_COLD static void ThrowLazy(const std::string_view& functionName, const MessageMaker& makeMessage, const char* const fileName, const uint32_t& line)
+        {
+            const auto message = makeMessage();
+
+            if constexpr(std::is_same_v<typename decltype(message)::value_type, wchar_t>)
+            {
+                std::string text;
+                AppendUTF8(text, message);
+
+                Throw<Exception>(Format(functionName, ": ", text), fileName, line);
+            }
+            else
+                Throw<Exception>(Format(functionName, ": ", message), fileName, line);
+        }
+
         /**
          * \brief if input bool is false, then it will bring throw of runtime_error
          */
-        template<Concepts::IsException Exception = std::exception>
+        template<Concepts::IsException Exception = DefaultException>
         static void Assert(const bool& condition, const std::string_view& message = "", const char* file = __FILE__, const uint32_t& line = __LINE__)
         {
             if(!condition)
@@ -277,7 +1780,7 @@ namespace GuelderConsoleLog
         /**
          * \brief if input bool is false, then it will bring throw of runtime_error
          */
-        template<typename Exception = std::exception>
+        template<typename Exception = DefaultException>
         static void Assert(const bool& condition, Exception&& exception)
         {
             if(!condition)
@@ -290,142 +1793,461 @@ namespace GuelderConsoleLog
         template<Concepts::STDOut... Args>
         constexpr static auto Format(Args&&... message)
         {
-            if constexpr(Concepts::IsThereAtLeastOneWideChar<Args...>)
-            {
-                std::wstring _out;
-                {
-                    std::wstringstream outStr;
-                    (outStr << ... << std::forward<Args>(message));
-                    _out = outStr.str();
-                }
-                std::erase(_out, L'\0');
-                return _out;
-            }
-            else
-            {
-                std::stringstream outStr;
-                (outStr << ... << std::forward<Args>(message));
-                return outStr.str();
-            }
+            std::basic_string<std::conditional_t<Concepts::IsThereAtLeastOneWideChar<Args...>, wchar_t, char>> out;
+            FormatTo(out, std::forward<Args>(message)...);
+            return out;
+        }
+        /**
+         * \brief Appends all the input params to out. Bools, chars, numbers(with std::to_chars) and strings are written directly, other types go through operator<<.
+         * Out must be std::wstring if at least one param is wide.
+         */
+        template<Concepts::Character Char, Concepts::STDOut... Args>
+        static void FormatTo(std::basic_string<Char>& out, Args&&... message)
+        {
+            static_assert(std::is_same_v<Char, wchar_t> || !Concepts::IsThereAtLeastOneWideChar<Args...>, "Logger::FormatTo: wide params need a wide string");
+
+            const size_t begin = out.size();
+
+            (Formatting::Append(out, message), ...);
+
+            //wide strings converted from multibyte ones may contain '\0'
+            if constexpr(std::is_same_v<Char, wchar_t>)
+                out.erase(std::remove(out.begin() + begin, out.end(), L'\0'), out.end());
         }
 
     private:
         struct LoggerHelper final
         {
             LoggerHelper();
+            ~LoggerHelper();
+        };
+
+        /**
+         * \brief Owning copy of LogRecord, which lives inside the async queue.
+         */
+        struct AsyncRecord final
+        {
+            AsyncRecord& operator=(const LogRecord& record)
+            {
+                line = record.line;
+                categoryName = record.categoryName;
+                level = record.level;
+                time = record.time;
+                category = record.category;
+                colored = record.colored;
+
+                return *this;
+            }
+
+            std::string line;
+            std::string_view categoryName;
+            LogLevel level = LogLevel::Info;
+            std::chrono::system_clock::time_point time;
+            CategoryState* category = nullptr;
+            bool colored = false;
         };
 
+        //defined in GuelderConsoleLog.cpp
+        struct AsyncBackend;
+
     private:
         static std::mutex logMutex;
+        //see WriterScope
+        static inline thread_local constinit bool isWriterThread = false;
 #ifdef WIN32
         static HANDLE console;
 #endif
 
+        //whether the standard output is a terminal, which understands ANSI colors
+        static bool colorsEnabled;
+
+        //TimestampPrecision in the lowest byte, TimestampZone in the next one
+        static std::atomic<uint32_t> timestampFormat;
+
+        static std::atomic<bool> asyncEnabled;
+        static AsyncBackend asyncBackend;
+
         //DON'T USE
         static const LoggerHelper loggerHelper;
 
     private:
-        template<Concepts::STDCout T>
-        static std::ostream& Out()
+        /**
+         * \brief Converts Windows console attributes to an ANSI SGR sequence, so colors travel inside the line.
+         */
+        template<typename String>
+        static constexpr void AppendColorSequence(String& line, const uint16_t& attributes)
         {
-            return std::cout;
+            //Windows keeps colors as BGR bits, ANSI as RGB
+            constexpr char ansiOrder[8] = { '0', '4', '2', '6', '1', '5', '3', '7' };
+
+            line.append("\x1b[");
+            line.push_back((attributes & 0x08) ? '9' : '3');
+            line.push_back(ansiOrder[attributes & 0x07]);
+            line.push_back(';');
+            if(attributes & 0x80)
+                line.append("10");
+            else
+                line.push_back('4');
+            line.push_back(ansiOrder[(attributes >> 4) & 0x07]);
+            line.push_back('m');
         }
-        template<Concepts::STDWout T>
-        static std::wostream& Out()
+        static void AppendColorReset(std::string& line)
         {
-            return std::wcout;
+            if(colorsEnabled)
+                line.append("\x1b[0m");
         }
-        
-#ifdef WIN32
-        template<Concepts::ConsoleColorAttributes... Attributes>
-        constexpr static void SetConsoleColorAttributes(Attributes&&... attrs)
+
+        /**
+         * \return Colors of the category name and of the message. Trace and Debug use the colors of Info.
+         */
+        template<LogLevel level, Colors::CategoryColors levelsColors>
+        static constexpr std::pair<uint16_t, uint16_t> GetLevelColors()
         {
-            SetConsoleTextAttribute(console, static_cast<uint16_t>((static_cast<uint16_t>(attrs) | ...)));
+            if constexpr(level == LogLevel::Warning)
+                return { levelsColors.warning.categoryColor, levelsColors.warning.messageColor };
+            else if constexpr(level == LogLevel::Error)
+                return { levelsColors.error.categoryColor, levelsColors.error.messageColor };
+            else
+                return { levelsColors.info.categoryColor, levelsColors.info.messageColor };
         }
-#endif
 
-        template<Concepts::STDOut Char, LogLevel loggingLevels, bool writeTime, Colors::CategoryColors levelsColors>
-        constexpr static void WriteLog(const LoggingCategory<loggingLevels, true, writeTime, levelsColors>& category, const LogLevel& level, const std::basic_string_view<Char>& message)
+        /**
+         * \brief "name: [LEVEL]: " with or without colors.
+         */
+        template<LogLevel level, Colors::CategoryColors levelsColors, typename String>
+        static constexpr void AppendPrefix(String& line, const std::string_view& name, const bool& colored)
         {
-            auto& _stdcout = Out<char>();
-            auto& _stdwout = Out<wchar_t>();
+            constexpr auto colors = GetLevelColors<level, levelsColors>();
 
-            std::lock_guard lock{ logMutex };
+            line.append(name);
+            line.append(": ");
+            if(colored)
+                AppendColorSequence(line, colors.first);
+            line.append(GetLogLevelTag(level));
+            if(colored)
+                AppendColorSequence(line, colors.second);
+            line.append(": ");
+        }
 
-            if constexpr(category.writeTime)
-            {
-                const auto t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                tm localTime;
-                localtime_s(&localTime, &t);
+        /**
+         * \brief Both variants of the prefix of a category type created by GE_DECLARE_LOG_CATEGORY_CONSTEXPR, made at compile time.
+         */
+        template<typename Category, LogLevel level>
+        struct LinePrefix final
+        {
+        private:
+            //2 color sequences are at most 16 chars, the longest tag is 9
+            static constexpr size_t capacity = Category::GetName().size() + 2 + 9 + 2 + 16 * 2;
 
-                _stdcout << std::put_time(&localTime, "%H:%M:%S") << ' '; // print timestamp
+            template<bool colored>
+            static constexpr Formatting::FixedString<capacity> Make()
+            {
+                Formatting::FixedString<capacity> prefix;
+                AppendPrefix<level, Category::levelsColors>(prefix, Category::GetName(), colored);
+                return prefix;
             }
 
-            _stdcout << category.name << ": ";
+        public:
+            static constexpr Formatting::FixedString<capacity> plain = Make<false>();
+            static constexpr Formatting::FixedString<capacity> colored = Make<true>();
+        };
 
-            using Background = ConsoleBackgroundColor;
-            using Text = ConsoleForegroundColor;
+        static tm ToLocalTime(const time_t& time)
+        {
+            tm localTime;
 #ifdef WIN32
-            if(level == LogLevel::Info && category.CanSupportLogLevel(LogLevel::Info))
+            localtime_s(&localTime, &time);
+#else
+            localtime_r(&time, &localTime);
+#endif
+            return localTime;
+        }
+        /**
+         * \brief Appends "HH:MM:SS[.fraction] ". "HH:MM:SS" is rendered again only when the second(or the format) changes, the fraction is patched in every time.
+         */
+        static void AppendTime(std::string& line, const std::chrono::system_clock::time_point& time)
+        {
+            struct Cache final
             {
-                SetConsoleColorAttributes(category.levelsColors.info.categoryColor);
-                _stdcout << "[INFO]";
-                SetConsoleColorAttributes(category.levelsColors.info.messageColor);
-            }
-            else if(level == LogLevel::Warning && category.CanSupportLogLevel(LogLevel::Warning))
+                int64_t second = std::numeric_limits<int64_t>::min();
+                uint32_t format = std::numeric_limits<uint32_t>::max();
+                char text[8]{};
+            };
+            thread_local Cache cache;
+
+            const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+            const int64_t second = nanoseconds >= 0 ? nanoseconds / 1'000'000'000 : (nanoseconds + 1) / 1'000'000'000 - 1;
+            const uint32_t format = timestampFormat.load(std::memory_order_relaxed);
+
+            if(second != cache.second || format != cache.format)
             {
-                SetConsoleColorAttributes(category.levelsColors.warning.categoryColor);
-                _stdcout << "[WARNING]";
-                SetConsoleColorAttributes(category.levelsColors.warning.messageColor);
+                int hour, minute, secondOfMinute;
+
+                if(static_cast<TimestampZone>((format >> 8) & 0xFF) == TimestampZone::UTC)
+                {
+                    const int64_t secondOfDay = (second % 86400 + 86400) % 86400;
+
+                    hour = static_cast<int>(secondOfDay / 3600);
+                    minute = static_cast<int>(secondOfDay / 60 % 60);
+                    secondOfMinute = static_cast<int>(secondOfDay % 60);
+                }
+                else
+                {
+                    const tm localTime = ToLocalTime(static_cast<time_t>(second));
+
+                    hour = localTime.tm_hour;
+                    minute = localTime.tm_min;
+                    secondOfMinute = localTime.tm_sec;
+                }
+
+                const char text[] =
+                {
+                    static_cast<char>('0' + hour / 10), static_cast<char>('0' + hour % 10), ':',
+                    static_cast<char>('0' + minute / 10), static_cast<char>('0' + minute % 10), ':',
+                    static_cast<char>('0' + secondOfMinute / 10), static_cast<char>('0' + secondOfMinute % 10)
+                };
+                std::copy(std::begin(text), std::end(text), cache.text);
+
+                cache.second = second;
+                cache.format = format;
             }
-            else if(level == LogLevel::Error && category.CanSupportLogLevel(LogLevel::Error))
+
+            line.append(cache.text, sizeof(cache.text));
+
+            //count of fraction digits: 0, 3, 6 or 9
+            const size_t digitsCount = static_cast<size_t>(format & 0xFF) * 3;
+
+            if(digitsCount != 0)
             {
-                SetConsoleColorAttributes(category.levelsColors.error.categoryColor);
-                _stdcout << "[ERROR]";
-                SetConsoleColorAttributes(category.levelsColors.error.messageColor);
+                char fraction[10];
+                fraction[0] = '.';
+
+                uint32_t value = static_cast<uint32_t>(nanoseconds - second * 1'000'000'000);
+                for(size_t i = digitsCount; i < 9; i += 3)
+                    value /= 1000;
+
+                for(size_t i = digitsCount; i > 0; --i)
+                {
+                    fraction[i] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                }
+
+                line.append(fraction, digitsCount + 1);
             }
-#else
-            if(level == LogLevel::Info && category.CanSupportLogLevel(LogLevel::Info))
-                _stdcout << "[INFO]";
-            else if(level == LogLevel::Warning && category.CanSupportLogLevel(LogLevel::Warning))
-                _stdcout << "[WARNING]";
-            else if(level == LogLevel::Error && category.CanSupportLogLevel(LogLevel::Error))
-                _stdcout << "[ERROR]";
-#endif
-            else
+
+            line.push_back(' ');
+        }
+
+        /**
+         * \brief Builds the whole line(time, category, level, colors, message) in a per-thread buffer without any lock and hands it to Output.
+         */
+        template<LogLevel level, typename Category, Concepts::STDOut... Args>
+        static void WriteLog(const Category& category, Args&&... args)
+        {
+            if constexpr(!Category::CanSupportLogLevel(level))
                 Throw(Format("Logger::WriteLog: invalid logging level or \"", category.name, "\" doesn't support any logging level"), __FILE__, __LINE__);
+            else
+            {
+                const bool written = IsWritten(category.state, level);
+
+                if(!written && !(category.state && FlightRecorder::IsEnabled(*category.state)))
+                    return;
+
+                const auto formatBegin = Metrics::IsEnabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+                const auto time = std::chrono::system_clock::now();
+
+                Formatting::ThreadLocalBuffer<char> buffer;
+                std::string& line = buffer.Get();
+
+                if constexpr(Category::writeTime)
+                    AppendTime(line, time);
+
+                if constexpr(requires { Category::GetName(); })
+                {
+                    using Prefix = LinePrefix<Category, level>;
+
+                    const auto& prefix = colorsEnabled ? Prefix::colored : Prefix::plain;
+                    line.append(prefix.data, prefix.size);
+                }
+                else
+                    AppendPrefix<level, Category::levelsColors>(line, category.name, colorsEnabled);
+
+                if(const std::string_view context = LogContext::GetLogfmt(); !context.empty())
+                {
+                    //without the leading space, the prefix ends with one
+                    line.append(context.substr(1));
+                    line.push_back(' ');
+                }
+
+                //wide params are transcoded right into the line
+                if constexpr(Concepts::IsThereAtLeastOneWideChar<Args...>)
+                    (Formatting::AppendAsUTF8(line, args), ...);
+                else
+                    FormatTo(line, std::forward<Args>(args)...);
+
+                AppendColorReset(line);
+                line.push_back('\n');
+
+                if(category.state)
+                    FlightRecorder::Record(*category.state, line, time);
+
+                if(written)
+                    Output(LogRecord{ line, category.name, level, time, category.state, colorsEnabled, formatBegin });
+            }
+        }
+
+        template<StructuredFormat format, LogLevel level, bool writeTime, typename Category, typename Message, typename... Fields>
+        static void WriteStructured(const Category& category, const Message& message, const Fields&... fields)
+        {
+            constexpr std::string_view levelTag = GetLogLevelTag(level);
+            //without the brackets
+            constexpr std::string_view levelName = levelTag.substr(1, levelTag.size() - 2);
+
+            const bool written = IsWritten(category.state, level);
+
+            if(!written && !(category.state && FlightRecorder::IsEnabled(*category.state)))
+                return;
+
+            const auto formatBegin = Metrics::IsEnabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+            const auto time = std::chrono::system_clock::now();
+
+            Formatting::ThreadLocalBuffer<char> buffer;
+            std::string& line = buffer.Get();
 
-            _stdcout << ": ";
+            if constexpr(format == StructuredFormat::JSON)
+            {
+                line.push_back('{');
+
+                if constexpr(writeTime)
+                {
+                    line.append("\"time\":\"");
+                    AppendTime(line, time);
+                    //AppendTime ends with a space
+                    line.back() = '"';
+                    line.push_back(',');
+                }
 
-            if constexpr(std::is_same_v<Char, char>)
-                _stdcout << message;
+                line.append("\"category\":");
+                Structured::AppendJSONString(line, category.name);
+                line.append(",\"level\":\"");
+                line.append(levelName);
+                line.push_back('"');
+                line.append(LogContext::GetJSON());
+            }
             else
-                _stdwout << message;
+            {
+                if constexpr(writeTime)
+                {
+                    line.append("time=");
+                    AppendTime(line, time);
+                }
 
-            _stdcout << '\n';
+                line.append("category=");
+                Structured::AppendLogfmtString(line, category.name);
+                line.append(" level=");
+                line.append(levelName);
+                line.append(LogContext::GetLogfmt());
+            }
 
-#ifdef WIN32
-            SetConsoleColorAttributes(Text::White, Background::Black);
-#endif
+            Structured::AppendField<format>(line, "msg", message);
+
+            if constexpr(sizeof...(Fields) != 0)
+                Structured::AppendFields<format>(line, fields...);
+
+            if constexpr(format == StructuredFormat::JSON)
+                line.push_back('}');
+            line.push_back('\n');
+
+            if(category.state)
+                FlightRecorder::Record(*category.state, line, time);
+
+            if(written)
+                Output(LogRecord{ line, category.name, level, time, category.state, false, formatBegin });
+        }
+
+        /**
+         * \return false if the level is below the category's runtime level or is shed, then the line is made only for FlightRecorder.
+         */
+        static bool IsWritten(const CategoryState* category, const LogLevel& level)
+        {
+            return !category || (static_cast<uint8_t>(level) >= category->minLevel.load(std::memory_order_relaxed) && static_cast<uint8_t>(level) >= category->shedLevel.load(std::memory_order_relaxed));
+        }
+
+        /**
+         * \brief Either pushes the record into the async queue or hands it to the sinks under logMutex.
+         */
+        static void Output(const LogRecord& record)
+        {
+            if(Metrics::IsEnabled()) [[unlikely]]
+            {
+                OutputWithMetrics(record);
+                return;
+            }
+
+            //acquire: the queue, which was made by StartAsync, is visible to PushAsync
+            if(asyncEnabled.load(std::memory_order_acquire))
+            {
+                PushAsync(record);
+                return;
+            }
+
+            if(LoadShedding::IsEnabled()) [[unlikely]]
+            {
+                OutputWithLoadShedding(record);
+                return;
+            }
+
+            std::lock_guard lock{ logMutex };
+            Dispatch(record);
         }
+        /**
+         * \brief Output, which also measures the record for Metrics.
+         */
+        static void OutputWithMetrics(const LogRecord& record);
+        /**
+         * \brief Synchronous Output, which measures the wait for logMutex for LoadShedding, if the mutex is taken.
+         */
+        static void OutputWithLoadShedding(const LogRecord& record);
+        /**
+         * \brief Writes the record to the sinks of its category. logMutex must be locked.
+         */
+        static void Dispatch(const LogRecord& record);
+
+        static void AddSink(CategoryState* category, const std::shared_ptr<Sink>& sink);
+        static void RemoveSinks(CategoryState* category);
+
+        /**
+         * \brief Makes the category visible for SetLogLevel by name.
+         */
+        static bool RegisterCategory(CategoryState* category);
+
+        template<typename Category>
+        static inline const bool categoryRegistered = RegisterCategory(&categoryState<Category>);
+
+        static void PushAsync(const LogRecord& record);
+        static void WakeAsyncWorker();
+        static void RunAsyncWorker();
+        /**
+         * \brief Writes all the records, which are in the queue now. logMutex must be locked.
+         * \return Count of written records.
+         */
+        static size_t DrainAsyncQueue();
+
+        //reads the async queue and logMutex for its snapshot
+        friend class Metrics;
+        //measures the async queue and writes its summary under logMutex
+        friend class LoadShedding;
     };
 }
 
 //the main logging category type
 namespace GuelderConsoleLog
 {
-#ifdef WIN32
     GE_DECLARE_LOG_LEVELS_COLORS_CONSTEXPR(Core,
         Colors::Background::Cyan | Colors::Text::White, Colors::Background::Black | Colors::Text::Cyan,
         Colors::Background::Yellow | Colors::Text::White, Colors::Background::Black | Colors::Text::Yellow,
         Colors::Background::Red | Colors::Text::White, Colors::Background::Black | Colors::Text::Red);
-#else
-    GE_DECLARE_LOG_LEVELS_COLORS_CONSTEXPR(Core,
-        0, 0,
-        0, 0,
-        0, 0);
-#endif
-    
+
     GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR(Core, All, true, true, true);
 }
 
@@ -442,8 +2264,27 @@ namespace GuelderConsoleLog
         Logger::Log<loggingLevels, _levelsColors, writeTime>(category, level, std::forward<Args>(info)...);
     }
 
+    /**
+     * \brief Use GE_LOG instead.
+     */
+    template<LogLevel level, typename Category, Concepts::STDOut... Args>
+    constexpr void Log(const Category& category, Args&&... info)
+    {
+        Logger::Log<level>(category, std::forward<Args>(info)...);
+    }
+
     //Added those just because it writes simpler rather than GE_LOG(Core, Info, ...)
 
+    template<typename... Args>
+    constexpr void LogTrace(Args&&... info)
+    {
+        GE_LOG(Core, Trace, std::forward<Args>(info)...);
+    }
+    template<typename... Args>
+    constexpr void LogDebug(Args&&... info)
+    {
+        GE_LOG(Core, Debug, std::forward<Args>(info)...);
+    }
     template<typename... Args>
     constexpr void LogInfo(Args&&... info)
     {
@@ -459,4 +2300,174 @@ namespace GuelderConsoleLog
     {
         GE_LOG(Core, Error, std::forward<Args>(info)...);
     }
-}
\ No newline at end of file
+}
+
+//rate limiting, is used by GE_LOG_EVERY_N, GE_LOG_ONCE, GE_LOG_EVERY_MS and GE_LOG_RATE_LIMITED
+namespace GuelderConsoleLog
+{
+    namespace RateLimiting
+    {
+        /**
+         * \brief Is appended to a message, which passed a rate limit: nothing if no message was suppressed before it.
+         */
+        struct Suppressed final
+        {
+            template<Concepts::Character Char>
+            void AppendTo(std::basic_string<Char>& out) const
+            {
+                if(count == 0)
+                    return;
+
+                Logger::FormatTo(out, " (", count, " similar messages suppressed)");
+            }
+
+            uint64_t count = 0;
+        };
+
+        template<typename Char>
+        std::basic_ostream<Char>& operator<<(std::basic_ostream<Char>& stream, const Suppressed& suppressed)
+        {
+            if(suppressed.count != 0)
+                stream << " (" << suppressed.count << " similar messages suppressed)";
+
+            return stream;
+        }
+
+        /**
+         * \brief Lets through the 1st, the (n + 1)th, the (2n + 1)th... message.
+         */
+        class EveryN final
+        {
+        public:
+            bool TryPass(const uint64_t& n, uint64_t& suppressed)
+            {
+                const uint64_t index = count.fetch_add(1, std::memory_order_relaxed);
+
+                if(n <= 1)
+                {
+                    suppressed = 0;
+                    return true;
+                }
+                if(index % n != 0)
+                    return false;
+
+                suppressed = index == 0 ? 0 : n - 1;
+                return true;
+            }
+
+        private:
+            std::atomic<uint64_t> count = 0;
+        };
+
+        /**
+         * \brief Lets through only the first message.
+         */
+        class Once final
+        {
+        public:
+            bool TryPass(uint64_t& suppressed)
+            {
+                suppressed = 0;
+                return !done.load(std::memory_order_relaxed) && !done.exchange(true, std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<bool> done = false;
+        };
+
+        /**
+         * \brief Lets through at most one message per interval.
+         */
+        class EveryInterval final
+        {
+        public:
+            bool TryPass(const std::chrono::nanoseconds& interval, uint64_t& suppressed)
+            {
+                const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                int64_t next = nextTime.load(std::memory_order_relaxed);
+
+                if(now < next || !nextTime.compare_exchange_strong(next, now + interval.count(), std::memory_order_relaxed))
+                {
+                    suppressedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            std::atomic<int64_t> nextTime = std::numeric_limits<int64_t>::min();
+            std::atomic<uint64_t> suppressedCount = 0;
+        };
+
+        /**
+         * \brief Token bucket: rate messages per second on average and bursts of up to burst messages.
+         * Is implemented as GCRA, so the whole state is one atomic time. If rate <= 0(or a token takes longer than int64 nanoseconds to be refilled),
+         * only burst messages pass at all. A burst can't reach further than int64 nanoseconds(~292 years) ahead of now.
+         */
+        class TokenBucket final
+        {
+        public:
+            bool TryPass(const double& rate, const uint64_t& burst, uint64_t& suppressed)
+            {
+                constexpr int64_t maxTime = std::numeric_limits<int64_t>::max();
+
+                //time, which one token takes to be refilled
+                const double interval = rate > 0.0 ? 1e9 / rate : std::numeric_limits<double>::infinity();
+                if(!(interval < static_cast<double>(maxTime)))
+                    return TryPassTotal(burst, suppressed);
+
+                const int64_t emissionInterval = static_cast<int64_t>(interval);
+                const uint64_t extraTokens = burst > 0 ? burst - 1 : 0;
+                const int64_t tolerance = emissionInterval != 0 && extraTokens > static_cast<uint64_t>(maxTime / emissionInterval) ? maxTime : emissionInterval * static_cast<int64_t>(extraTokens);
+
+                const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                int64_t arrivalTime = theoreticalArrivalTime.load(std::memory_order_relaxed);
+
+                while(true)
+                {
+                    const bool isFirst = arrivalTime == std::numeric_limits<int64_t>::min();
+                    const int64_t base = isFirst ? now : std::max(arrivalTime, now);
+
+                    if((!isFirst && arrivalTime > now && arrivalTime - now > tolerance) || base > maxTime - emissionInterval)
+                    {
+                        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+
+                    if(theoreticalArrivalTime.compare_exchange_weak(arrivalTime, base + emissionInterval, std::memory_order_relaxed))
+                        break;
+                }
+
+                suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            bool TryPassTotal(const uint64_t& burst, uint64_t& suppressed)
+            {
+                const uint64_t allowedCount = std::max<uint64_t>(burst, 1);
+                uint64_t passed = passedCount.load(std::memory_order_relaxed);
+
+                do
+                {
+                    if(passed >= allowedCount)
+                    {
+                        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                } while(!passedCount.compare_exchange_weak(passed, passed + 1, std::memory_order_relaxed));
+
+                suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+                return true;
+            }
+
+        private:
+            std::atomic<int64_t> theoreticalArrivalTime = std::numeric_limits<int64_t>::min();
+            //is used instead of the time, if no token is ever refilled
+            std::atomic<uint64_t> passedCount = 0;
+            std::atomic<uint64_t> suppressedCount = 0;
+        };
+    }
+}
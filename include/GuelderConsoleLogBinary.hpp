@@ -0,0 +1,276 @@
+#pragma once
+
+#include "GuelderConsoleLog.hpp"
+
+#include <filesystem>
+#include <cstring>
+
+//binary log format
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief How one argument of GE_LOG_BINARY is stored. Everything, which is neither a number nor a char, is stored as a UTF-8 string.
+     */
+    enum class BinaryArgType : uint8_t
+    {
+        Bool,
+        Char,
+        //stored as uint32_t code point
+        WideChar,
+        Int8,
+        Int16,
+        Int32,
+        Int64,
+        UInt8,
+        UInt16,
+        UInt32,
+        UInt64,
+        Float,
+        Double,
+        //uint32_t length + UTF-8 bytes
+        String
+    };
+
+    /**
+     * \brief Layout of the file written by BinaryLogger:
+     * header: magic, version(uint32_t), TimestampPrecision(uint8_t), TimestampZone(uint8_t), UTC offset of the local time in seconds(int32_t),
+     * then entries: EntryKind(uint8_t), payload size(uint32_t), payload.
+     * CallSite payload: id(uint32_t), LogLevel(uint8_t), writeTime(uint8_t), category name length(uint16_t), name, args count(uint16_t), BinaryArgType of every arg.
+     * Record payload: id(uint32_t), time in nanoseconds since the epoch(int64_t, only if writeTime), LogContext fields length(uint16_t),
+     * the fields(" key=value" as LogContext::GetLogfmt returns them), args.
+     * UTCOffset payload: UTC offset of the local time in seconds(int32_t), which the following records have(e.g. after a DST change).
+     * A call site is always defined before its first record. Numbers are stored in the byte order of the writing machine.
+     */
+    namespace BinaryFormat
+    {
+        constexpr char magic[4] = { 'G', 'E', 'B', 'L' };
+        constexpr uint32_t version = 4;
+
+        enum class EntryKind : uint8_t
+        {
+            CallSite = 1,
+            Record = 2,
+            UTCOffset = 3
+        };
+    }
+
+    /**
+     * \brief Everything about one GE_LOG_BINARY call, what is known at compile time.
+     */
+    struct BinaryCallSite final
+    {
+        std::string_view categoryName;
+        LogLevel level = LogLevel::Info;
+        bool writeTime = false;
+        std::vector<BinaryArgType> argTypes;
+    };
+}
+
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Deferred-formatting logging: GE_LOG_BINARY copies a call site id and raw bytes of the arguments into a per-thread buffer,
+     * a background thread moves them into a binary file, which is turned into text by GuelderConsoleLogDecoder.
+     * While BinaryLogger isn't started, GE_LOG_BINARY works as GE_LOG.
+     */
+    class BinaryLogger final
+    {
+    public:
+        struct Options final
+        {
+            //per logging thread, a record must be smaller than a half of it
+            size_t stagingBufferSize = 1 << 20;
+            size_t fileBufferSize = 1 << 20;
+            //how long the background thread sleeps, when there is nothing to write
+            std::chrono::microseconds pollInterval{ 1000 };
+        };
+
+    public:
+        BinaryLogger() = delete;
+        ~BinaryLogger() = delete;
+
+        /**
+         * \brief Opens(truncates) the file and starts the background thread. Throws if the file can't be opened.
+         */
+        static void Start(const std::filesystem::path& path, const Options& options);
+        static void Start(const std::filesystem::path& path);
+        /**
+         * \brief Writes everything left and closes the file. Is called automatically at exit.
+         * WARNING: must not be called while other threads are logging with GE_LOG_BINARY.
+         */
+        static void Stop();
+        /**
+         * \brief Blocks until every record, which was logged before this call, is written to the file.
+         */
+        static void Flush();
+
+        [[nodiscard]]
+        static bool IsRunning();
+        /**
+         * \return Count of records, which didn't fit into a staging buffer.
+         */
+        [[nodiscard]]
+        static uint64_t GetDroppedCount();
+
+        /**
+         * \brief Use GE_LOG_BINARY instead.
+         * \tparam CallSiteTag Unique type of every call site.
+         */
+        template<LogLevel level, typename Category, typename CallSiteTag, Concepts::STDOut... Args>
+        static void Log(const Category& category, const CallSiteTag&, Args&&... args)
+        {
+            if constexpr(Category::enable && level >= minLogLevel)
+            {
+                const uint32_t id = CallSite<CallSiteTag, Category, level, std::remove_cvref_t<Args>...>::id;
+
+                if(!running.load(std::memory_order_relaxed) || id == 0 || !Category::CanSupportLogLevel(level))
+                {
+                    Logger::Log<level>(category, std::forward<Args>(args)...);
+                    return;
+                }
+
+                thread_local std::string record;
+                record.clear();
+
+                Append(record, id);
+
+                if constexpr(Category::writeTime)
+                    Append(record, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+
+                const std::string_view context = LogContext::GetLogfmt();
+                Append(record, static_cast<uint16_t>(context.size()));
+                record.append(context);
+
+                (AppendArg(record, args), ...);
+
+                Submit(record);
+            }
+        }
+
+        /**
+         * \return BinaryCallSite registered with the id, nullptr if there is none.
+         */
+        [[nodiscard]]
+        static const BinaryCallSite* GetCallSite(const uint32_t& id);
+
+    private:
+        //defined in GuelderConsoleLogBinary.cpp
+        struct Backend;
+        class StagingBuffer;
+
+        template<typename CallSiteTag, typename Category, LogLevel level, typename... Args>
+        struct CallSite;
+
+    private:
+        static std::atomic<bool> running;
+
+    private:
+        static Backend& GetBackend();
+        static void RunWorker();
+
+        static uint32_t RegisterCallSite(BinaryCallSite&& callSite);
+        /**
+         * \brief Copies the record into the thread's staging buffer.
+         */
+        static void Submit(const std::string_view& record);
+
+        template<typename T>
+        static void Append(std::string& out, const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        template<typename T>
+        static constexpr BinaryArgType GetArgType()
+        {
+            if constexpr(std::is_same_v<T, bool>)
+                return BinaryArgType::Bool;
+            else if constexpr(std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>)
+                return BinaryArgType::Char;
+            else if constexpr(std::is_same_v<T, wchar_t>)
+                return BinaryArgType::WideChar;
+            else if constexpr(std::is_integral_v<T> && std::is_signed_v<T>)
+            {
+                if constexpr(sizeof(T) == 1)
+                    return BinaryArgType::Int8;
+                else if constexpr(sizeof(T) == 2)
+                    return BinaryArgType::Int16;
+                else if constexpr(sizeof(T) == 4)
+                    return BinaryArgType::Int32;
+                else
+                    return BinaryArgType::Int64;
+            }
+            else if constexpr(std::is_integral_v<T>)
+            {
+                if constexpr(sizeof(T) == 1)
+                    return BinaryArgType::UInt8;
+                else if constexpr(sizeof(T) == 2)
+                    return BinaryArgType::UInt16;
+                else if constexpr(sizeof(T) == 4)
+                    return BinaryArgType::UInt32;
+                else
+                    return BinaryArgType::UInt64;
+            }
+            else if constexpr(std::is_same_v<T, float>)
+                return BinaryArgType::Float;
+            //long double is stored as double, it is written with precision 6 anyway
+            else if constexpr(std::is_floating_point_v<T>)
+                return BinaryArgType::Double;
+            else
+                return BinaryArgType::String;
+        }
+
+        template<typename T>
+        static void AppendArg(std::string& out, const T& value)
+        {
+            using Type = std::remove_cvref_t<T>;
+            constexpr BinaryArgType type = GetArgType<Type>();
+
+            if constexpr(type == BinaryArgType::Bool || type == BinaryArgType::Char)
+                out.push_back(static_cast<char>(value));
+            else if constexpr(type == BinaryArgType::WideChar)
+                Append(out, static_cast<uint32_t>(value));
+            else if constexpr(type == BinaryArgType::Double)
+                Append(out, static_cast<double>(value));
+            else if constexpr(type != BinaryArgType::String)
+                Append(out, value);
+            else if constexpr(Concepts::StringLike<Type, char>)
+            {
+                std::string_view string;
+                if constexpr(std::is_pointer_v<Type>)
+                {
+                    if(value != nullptr)
+                        string = value;
+                }
+                else
+                    string = value;
+
+                Append(out, static_cast<uint32_t>(string.size()));
+                out.append(string);
+            }
+            else
+            {
+                //the text is made right here, the decoder gets only the result
+                Formatting::ThreadLocalBuffer<char> buffer;
+                std::string& text = buffer.Get();
+
+                Formatting::AppendAsUTF8(text, value);
+
+                Append(out, static_cast<uint32_t>(text.size()));
+                out.append(text);
+            }
+        }
+
+    private:
+        template<typename CallSiteTag, typename Category, LogLevel level, typename... Args>
+        struct CallSite final
+        {
+            //0 until registration, it happens during static initialization
+            static inline const uint32_t id = RegisterCallSite(BinaryCallSite{ Category::GetName(), level, Category::writeTime, { GetArgType<Args>()... } });
+        };
+    };
+}
\ No newline at end of file
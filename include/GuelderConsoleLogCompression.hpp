@@ -0,0 +1,106 @@
+#pragma once
+
+#include "GuelderConsoleLog.hpp"
+
+//LZ block codec
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Fast byte-oriented LZ77 codec(the LZ4 block format) without any state between blocks, so every block is decompressed on its own.
+     * A sequence is a token(4 bits of the literals count, 4 bits of the match length - minMatchLength), the literals, a 2-byte little-endian offset
+     * and the rest of the match length. Counts of 15 go on with bytes of 255 until a smaller one. The last sequence has only literals.
+     */
+    namespace Compression
+    {
+        constexpr size_t minMatchLength = 4;
+        constexpr size_t maxOffset = 65535;
+        //the last bytes of a block are always literals
+        constexpr size_t lastLiteralsCount = 5;
+        //a match doesn't start this close to the end
+        constexpr size_t matchStartLimit = 12;
+
+        [[nodiscard]]
+        constexpr size_t GetMaxCompressedSize(const size_t& size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        /**
+         * \param out Must have GetMaxCompressedSize(size) bytes.
+         * \return Count of written bytes.
+         */
+        size_t Compress(const char* in, const size_t& size, char* out);
+        /**
+         * \brief Checks every count and offset, so a corrupted block can't write or read outside the buffers.
+         * \return false if the block is corrupted or doesn't decompress to exactly outSize bytes.
+         */
+        [[nodiscard]]
+        bool Decompress(const char* in, const size_t& inSize, char* out, const size_t& outSize);
+    }
+}
+
+//compressed log format
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Layout of a file written by FileSink with Options::compress: frames one after another, every frame is FrameHeader, then compressedSize bytes.
+     * Frames are independent and their headers tell their time ranges, so a reader can jump from header to header and decompress only the frames it needs.
+     * Numbers are stored in the byte order of the writing machine.
+     */
+    namespace CompressedFormat
+    {
+        constexpr char magic[4] = { 'G', 'E', 'L', 'Z' };
+        constexpr uint16_t version = 1;
+
+        //flags of FrameHeader
+        //the data didn't get smaller, it is stored as is
+        constexpr uint16_t storedFlag = 1 << 0;
+
+        struct FrameHeader final
+        {
+            char magic[4];
+            uint16_t version;
+            uint16_t flags;
+            uint32_t compressedSize;
+            uint32_t uncompressedSize;
+            //of the lines, which end in the frame
+            uint32_t recordsCount;
+            //of all the fields above and below, lets a reader find the next frame after a damaged one
+            uint32_t headerChecksum;
+            //nanoseconds since the epoch of the earliest and the latest record, 0 if there are no records
+            int64_t minTime;
+            int64_t maxTime;
+        };
+
+        static_assert(sizeof(FrameHeader) == 40, "FrameHeader mustn't have padding");
+
+        [[nodiscard]]
+        inline uint32_t GetHeaderChecksum(const FrameHeader& header)
+        {
+            FrameHeader copy = header;
+            copy.headerChecksum = 0;
+
+            char bytes[sizeof(FrameHeader)];
+            std::memcpy(bytes, &copy, sizeof(bytes));
+
+            //FNV-1a
+            uint32_t hash = 2166136261u;
+            for(const char& byte : bytes)
+            {
+                hash ^= static_cast<unsigned char>(byte);
+                hash *= 16777619u;
+            }
+
+            return hash;
+        }
+
+        /**
+         * \return Whether the header can be trusted: the magic, the version and the checksum are right.
+         */
+        [[nodiscard]]
+        inline bool IsValid(const FrameHeader& header)
+        {
+            return std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == version && header.headerChecksum == GetHeaderChecksum(header);
+        }
+    }
+}
@@ -10,6 +10,18 @@
 #endif
 #endif
 
+/**
+ * \brief Name of the lowest LogLevel, which is compiled in(Trace, Debug, Info, Warning or Error), GE_LOG calls below it compile to nothing.
+ * Defaults to Trace with GE_DEBUG and to Info otherwise.
+ */
+#ifndef GE_MIN_LOG_LEVEL
+#ifdef GE_DEBUG
+#define GE_MIN_LOG_LEVEL Trace
+#else
+#define GE_MIN_LOG_LEVEL Info
+#endif
+#endif
+
 #ifndef GE_LOCALE
 #define GE_LOCALE ""
 #endif
@@ -24,13 +36,22 @@
 #define GE_FULL_FUNC_NAME GE_FUNC_NAME
 #endif
 
+//marks a function, which is called only when something went wrong, so it is kept out of the callers' code
+#if defined(_MSC_VER)
+#define GE_COLD __declspec(noinline)
+#elif defined(__GNUC__) || defined(__clang__)
+#define GE_COLD __attribute__((cold, noinline))
+#else
+#define GE_COLD
+#endif
+
 #define GE_MSG_METHOD_LOGGING(...) ::GuelderConsoleLog::Logger::Format(GE_FULL_FUNC_NAME, ": ", __VA_ARGS__)
 
 /**
- * \brief Throws an std::exception.
+ * \brief Throws an std::exception. The message is made inside an out-of-line cold function.
  * \param ... Message(any type that supports "<<" operator for std::cout), which will be put inside an std::exception.
  */
-#define GE_THROW(...) ::GuelderConsoleLog::Logger::Throw(::GuelderConsoleLog::Logger::Format(GE_FULL_FUNC_NAME, ": ", __VA_ARGS__), __FILE__, __LINE__)
+#define GE_THROW(...) ::GuelderConsoleLog::Logger::ThrowLazy(GE_FULL_FUNC_NAME, [&] { return ::GuelderConsoleLog::Logger::Format(__VA_ARGS__); }, __FILE__, __LINE__)
 /**
  * \brief Throws something.
  * \param exception Some object, which will be thrown.
@@ -39,10 +60,16 @@
 
 /**
  * \brief If condition is false then it will throw exception. Prints the path of the file and message(msg).
+ * The message is made only if the condition is false, so the passing path is one compare and branch.
  * \param condition If false -> throw an error.
  * \param ... Message, which will be put inside std::exception.
  */
-#define GE_ASSERT(condition, ...) ::GuelderConsoleLog::Logger::Assert(condition, ::GuelderConsoleLog::Logger::Format(GE_FULL_FUNC_NAME, ": ", __VA_ARGS__), __FILE__, __LINE__)
+#define GE_ASSERT(condition, ...)\
+    do\
+    {\
+        if(!static_cast<bool>(condition)) [[unlikely]]\
+            GE_THROW(__VA_ARGS__);\
+    } while(false)
 /**
  * \brief If condition is false then it will throw exception. Prints the path of the file and message(msg).
  * \param condition If false -> throw an error.
@@ -73,16 +100,17 @@
 /**
  * \brief Creates a logging type for a constexpr variable, which is also created here.
  * \param name Name of the logging category.
- * \param loggingLevels Supported logging levels.
+ * \param loggingLevels Supported logging levels: a name of LogLevel or a mask(e.g. Warning | ::GuelderConsoleLog::LogLevel::Error).
  * \param enable Whether the logging category works.
  * \param debugOnly Whether this logging category works, when GE_DEBUG and GE_NO_DEBUG are not defined.
  * \param writeTime Whether put time before the message being output.
  * \param colors Colors, which logging category will be using(If you don't care use GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR).
  */
 #define GE_DECLARE_LOG_CATEGORY_CONSTEXPR(name, loggingLevels, enable, debugOnly, writeTime, colors)\
-    struct GE_LOG_CATEGORY_TYPE(name) final : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::##loggingLevels, enable, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>\
+    struct GE_LOG_CATEGORY_TYPE(name) final : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::loggingLevels, enable, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>\
     {\
-        constexpr GE_LOG_CATEGORY_TYPE(name)() : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::##loggingLevels, enable, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>(GE_TO_STRING(name)) {}\
+        static constexpr ::std::string_view GetName() { return GE_TO_STRING(name); }\
+        constexpr GE_LOG_CATEGORY_TYPE(name)() : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::loggingLevels, enable, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>(GetName(), &::GuelderConsoleLog::categoryState<GE_LOG_CATEGORY_TYPE(name)>) {}\
     };\
         constexpr GE_LOG_CATEGORY_TYPE(name) GE_LOG_CATEGORY_VARIABLE(name)
 
@@ -93,16 +121,17 @@
 /**
  * \brief Creates a logging type for a constexpr variable, which is also created here.
  * \param name Name of the logging category.
- * \param loggingLevels Supported logging levels.
+ * \param loggingLevels Supported logging levels: a name of LogLevel or a mask(e.g. Warning | ::GuelderConsoleLog::LogLevel::Error).
  * \param enable Whether the logging category works.
  * \param debugOnly Whether this logging category works, when GE_DEBUG and GE_NO_DEBUG are not defined.
  * \param writeTime Whether put time before the message being output.
  * \param colors Colors, which logging category will be using(If you don't care use GE_DECLARE_LOG_CATEGORY_DEFAULT_COLORS_CONSTEXPR).
  */
 #define GE_DECLARE_LOG_CATEGORY_CONSTEXPR(name, loggingLevels, enable, debugOnly, writeTime, colors)\
-    struct GE_LOG_CATEGORY_TYPE(name) final : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::##loggingLevels, enable && !debugOnly, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>\
+    struct GE_LOG_CATEGORY_TYPE(name) final : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::loggingLevels, enable && !debugOnly, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>\
     {\
-        constexpr GE_LOG_CATEGORY_TYPE(name)() : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::##loggingLevels, enable && !debugOnly, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>(GE_TO_STRING(name)) {}\
+        static constexpr ::std::string_view GetName() { return GE_TO_STRING(name); }\
+        constexpr GE_LOG_CATEGORY_TYPE(name)() : ::GuelderConsoleLog::LoggingCategory<::GuelderConsoleLog::LogLevel::loggingLevels, enable && !debugOnly, writeTime, GE_LOG_LEVELS_COLORS_VARIABLE(colors)>(GetName(), &::GuelderConsoleLog::categoryState<GE_LOG_CATEGORY_TYPE(name)>) {}\
     };\
         constexpr GE_LOG_CATEGORY_TYPE(name) GE_LOG_CATEGORY_VARIABLE(name)
 
@@ -116,10 +145,155 @@
 
 #define GE_LOG(...)
 
+#define GE_ADD_LOG_SINK(...)
+
+#define GE_SET_LOG_LEVEL(...)
+
+#define GE_SET_LOG_FLIGHT_RECORDER(...)
+
+#define GE_DECLARE_LOG_SHEDDING_POLICY(...)
+
+#define GE_LOG_KV(...)
+
+#define GE_SET_LOG_STRUCTURED_FORMAT(...)
+
+#define GE_LOG_SCOPE_FIELD(...)
+
+#define GE_LOG_EVERY_N(...)
+
+#define GE_LOG_ONCE(...)
+
+#define GE_LOG_EVERY_MS(...)
+
+#define GE_LOG_RATE_LIMITED(...)
+
+#define GE_LOG_BINARY(...)
+
+#define GE_PROFILE_SCOPE(...)
+
+#define GE_PROFILE_FUNCTION(...)
+
 #else
 
 #define GE_DECLARE_LOG_LEVELS_COLORS_CONSTEXPR(name, infoCategory, infoMessage, warningCategory, warningMessage, errorCategory, errorMessage) Colors::CategoryColors<Colors::CategoryColor<infoCategory, infoMessage>{}, Colors::CategoryColor<warningCategory, warningMessage>{}, Colors::CategoryColor<errorCategory, errorMessage>{}> constexpr GE_LOG_LEVELS_COLORS_VARIABLE(name)
 
-#define GE_LOG(categoryName, level, ...) ::GuelderConsoleLog::Log<GE_LOG_CATEGORY_TYPE(categoryName)::supportedLoggingLevels, GE_LOG_CATEGORY_TYPE(categoryName)::enable, GE_LOG_CATEGORY_TYPE(categoryName)::writeTime, GE_LOG_CATEGORY_TYPE(categoryName)::levelsColors>(GE_LOG_CATEGORY_VARIABLE(categoryName), ::GuelderConsoleLog::LogLevel::##level, __VA_ARGS__)
+/**
+ * \brief Writes the message if the category supports the level and the level isn't below the category's runtime level(GE_SET_LOG_LEVEL).
+ * The arguments are evaluated only if the message is written.
+ */
+#define GE_LOG(categoryName, level, ...)\
+    do\
+    {\
+        if(::GuelderConsoleLog::Logger::IsLogLevelEnabled<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+            ::GuelderConsoleLog::Log<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), __VA_ARGS__);\
+    } while(false)
+
+#define GE_LOG_RATE_LIMITED_IMPL(stateType, categoryName, level, tryPass, ...)\
+    do\
+    {\
+        static stateType geRateLimitState;\
+        uint64_t geSuppressedCount = 0;\
+        if(::GuelderConsoleLog::Logger::IsLogLevelEnabled<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+        {\
+            if(!::GuelderConsoleLog::Logger::IsLogLevelWritten<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+                ::GuelderConsoleLog::Log<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), __VA_ARGS__);\
+            else if(geRateLimitState.tryPass)\
+            {\
+                ::GuelderConsoleLog::Metrics::AddSuppressed(GE_LOG_CATEGORY_VARIABLE(categoryName), geSuppressedCount);\
+                ::GuelderConsoleLog::Log<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), __VA_ARGS__, ::GuelderConsoleLog::RateLimiting::Suppressed{ geSuppressedCount });\
+            }\
+        }\
+    } while(false)
+
+/**
+ * \brief GE_LOG, which writes only every n-th message of this call site(the 1st, the (n + 1)th, ...). Skipped messages aren't formatted,
+ * the written one tells how many were skipped before it.
+ */
+#define GE_LOG_EVERY_N(categoryName, level, n, ...) GE_LOG_RATE_LIMITED_IMPL(::GuelderConsoleLog::RateLimiting::EveryN, categoryName, level, TryPass(n, geSuppressedCount), __VA_ARGS__)
+/**
+ * \brief GE_LOG, which writes only the first message of this call site.
+ */
+#define GE_LOG_ONCE(categoryName, level, ...) GE_LOG_RATE_LIMITED_IMPL(::GuelderConsoleLog::RateLimiting::Once, categoryName, level, TryPass(geSuppressedCount), __VA_ARGS__)
+/**
+ * \brief GE_LOG, which writes at most one message of this call site per intervalMs milliseconds.
+ */
+#define GE_LOG_EVERY_MS(categoryName, level, intervalMs, ...) GE_LOG_RATE_LIMITED_IMPL(::GuelderConsoleLog::RateLimiting::EveryInterval, categoryName, level, TryPass(::std::chrono::milliseconds{ intervalMs }, geSuppressedCount), __VA_ARGS__)
+/**
+ * \brief GE_LOG with a token bucket per call site: ratePerSecond messages per second on average, bursts of up to burst messages.
+ */
+#define GE_LOG_RATE_LIMITED(categoryName, level, ratePerSecond, burst, ...) GE_LOG_RATE_LIMITED_IMPL(::GuelderConsoleLog::RateLimiting::TokenBucket, categoryName, level, TryPass(ratePerSecond, burst, geSuppressedCount), __VA_ARGS__)
+
+/**
+ * \brief Structured GE_LOG: GE_LOG_KV(Core, Info, "message", "user", id, "latency_us", t) writes a JSON line or a logfmt line(GE_SET_LOG_STRUCTURED_FORMAT)
+ * with the time, the category, the level, the message and the fields. The arguments are evaluated only if the message is written.
+ */
+#define GE_LOG_KV(categoryName, level, ...)\
+    do\
+    {\
+        if(::GuelderConsoleLog::Logger::IsLogLevelEnabled<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+            ::GuelderConsoleLog::Logger::LogStructured<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), __VA_ARGS__);\
+    } while(false)
+
+/**
+ * \brief Sets how GE_LOG_KV writes lines of the category: JSON(the default) or Logfmt.
+ */
+#define GE_SET_LOG_STRUCTURED_FORMAT(categoryName, format) ::GuelderConsoleLog::Logger::SetStructuredFormat(GE_LOG_CATEGORY_VARIABLE(categoryName), ::GuelderConsoleLog::StructuredFormat::format)
+
+/**
+ * \brief Messages of the category below the level are skipped from now on, can be changed at any moment.
+ * Use GuelderConsoleLog::Logger::SetLogLevel to set it by the category name.
+ */
+#define GE_SET_LOG_LEVEL(categoryName, level) ::GuelderConsoleLog::Logger::SetLogLevel(GE_LOG_CATEGORY_VARIABLE(categoryName), ::GuelderConsoleLog::LogLevel::level)
+
+/**
+ * \brief Every thread keeps the last recordsCount lines of the category in memory(even the ones below its runtime level),
+ * they are written to the standard error when GE_ASSERT or GE_THROW fails or the process crashes. 0 turns it off.
+ */
+#define GE_SET_LOG_FLIGHT_RECORDER(categoryName, recordsCount) ::GuelderConsoleLog::FlightRecorder::SetSize(GE_LOG_CATEGORY_VARIABLE(categoryName), recordsCount)
+
+/**
+ * \brief Adds "key=value" to every line logged by the thread until the end of the enclosing scope(GuelderConsoleLog::LogContext).
+ * GuelderConsoleLog::LogContext::Capture and GuelderConsoleLog::LogContext::Restore carry the fields to other threads.
+ */
+#define GE_LOG_SCOPE_FIELD(key, value) const ::GuelderConsoleLog::LogContext::Field GE_CONCATENATE(geLogScopeField, __LINE__){ key, value }
+
+/**
+ * \brief Declares which levels of the category GuelderConsoleLog::LoadShedding keeps while the output can't keep up, e.g. GE_DECLARE_LOG_SHEDDING_POLICY(Net, Info, Warning).
+ * Is placed next to GE_DECLARE_LOG_CATEGORY_CONSTEXPR. Error is always written.
+ * \param elevatedMinLevel Lowest level written under elevated backpressure.
+ * \param highMinLevel Lowest level written under high backpressure.
+ */
+#define GE_DECLARE_LOG_SHEDDING_POLICY(categoryName, elevatedMinLevel, highMinLevel) inline const bool GE_CONCATENATE(categoryName, SheddingPolicyDeclared) = ::GuelderConsoleLog::LoadShedding::SetPolicy(GE_LOG_CATEGORY_VARIABLE(categoryName), ::GuelderConsoleLog::LogLevel::elevatedMinLevel, ::GuelderConsoleLog::LogLevel::highMinLevel)
+
+/**
+ * \brief Routes the logging category to a sink(std::shared_ptr<GuelderConsoleLog::Sink>), a category can have several sinks.
+ */
+#define GE_ADD_LOG_SINK(categoryName, sink) ::GuelderConsoleLog::Logger::AddSink(GE_LOG_CATEGORY_VARIABLE(categoryName), sink)
+
+/**
+ * \brief Same as GE_LOG, but while GuelderConsoleLog::BinaryLogger is running(GuelderConsoleLogBinary.hpp), only raw bytes of the arguments are written,
+ * the text is made later by GuelderConsoleLogDecoder. Lines below the category's level, which are made only for FlightRecorder, are made as text.
+ */
+#define GE_LOG_BINARY(categoryName, level, ...)\
+    do\
+    {\
+        if(::GuelderConsoleLog::Logger::IsLogLevelEnabled<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+        {\
+            if(::GuelderConsoleLog::Logger::IsLogLevelWritten<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName)))\
+                ::GuelderConsoleLog::BinaryLogger::Log<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), []{}, __VA_ARGS__);\
+            else\
+                ::GuelderConsoleLog::Log<::GuelderConsoleLog::LogLevel::level>(GE_LOG_CATEGORY_VARIABLE(categoryName), __VA_ARGS__);\
+        }\
+    } while(false)
+
+/**
+ * \brief Measures the time until the end of the enclosing scope and puts it into a per-thread histogram(GuelderConsoleLogProfiler.hpp).
+ * GuelderConsoleLog::Profiler writes a summary line of the scope through the category every reporting interval.
+ */
+#define GE_PROFILE_SCOPE(categoryName, name) const ::GuelderConsoleLog::Profiler::Scope GE_CONCATENATE(geProfileScope, __LINE__){ ::GuelderConsoleLog::Profiler::GetScopeId(GE_LOG_CATEGORY_VARIABLE(categoryName), name, []{}) }
+/**
+ * \brief GE_PROFILE_SCOPE named after the enclosing function.
+ */
+#define GE_PROFILE_FUNCTION(categoryName) GE_PROFILE_SCOPE(categoryName, GE_FULL_FUNC_NAME)
 
 #endif
\ No newline at end of file
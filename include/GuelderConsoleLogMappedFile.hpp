@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GuelderConsoleLog.hpp"
+
+#include <filesystem>
+
+//memory mapped file, is used by SharedMemorySink and by the tools, which read logs
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief File mapped into the memory of the process for reading and writing.
+     */
+    class MappedFile final
+    {
+    public:
+        /**
+         * \brief Creates(truncates) the file with the size and maps it. Throws on failure.
+         */
+        static std::unique_ptr<MappedFile> Create(const std::filesystem::path& path, const size_t& size);
+        /**
+         * \return nullptr on failure.
+         */
+        static std::unique_ptr<MappedFile> Open(const std::filesystem::path& path);
+        /**
+         * \brief Maps the whole file only for reading, writing to GetData crashes.
+         * \return nullptr on failure.
+         */
+        static std::unique_ptr<MappedFile> OpenReadOnly(const std::filesystem::path& path);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]]
+        char* GetData() const;
+        [[nodiscard]]
+        size_t GetSize() const;
+
+    private:
+        MappedFile() = default;
+
+        static std::unique_ptr<MappedFile> Open(const std::filesystem::path& path, const bool& writable);
+
+    private:
+        char* data = nullptr;
+        size_t size = 0;
+#ifdef WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "GuelderConsoleLog.hpp"
+
+#include <bit>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define GE_PROFILER_TSC
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GE_PROFILER_TSC
+#include <x86intrin.h>
+#endif
+
+//profiling
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief GE_PROFILE_SCOPE and GE_PROFILE_FUNCTION put durations of scopes into per-thread histograms without any lock,
+     * Profiler merges them and writes one line per scope through the scope's category: count, mean, p50, p99 and max of the durations since the previous report.
+     */
+    class Profiler final
+    {
+    public:
+        /**
+         * \brief Log-linear histogram: values below subBucketsCount are exact, every next power of two is split into subBucketsCount buckets(the error is below 12.5%).
+         */
+        static constexpr size_t subBucketsCount = 8;
+        static constexpr size_t bucketsCount = (64 - std::bit_width(subBucketsCount) + 2) * subBucketsCount;
+
+        /**
+         * \brief Durations of one scope measured by one thread, only the owning thread writes them.
+         */
+        struct Histogram final
+        {
+            std::atomic<uint64_t> buckets[bucketsCount] = {};
+            //in ticks of GetTicks
+            std::atomic<uint64_t> sum = 0;
+            //since the previous report
+            std::atomic<uint64_t> max = 0;
+
+            uint32_t scopeId = 0;
+            std::atomic<bool> owned = true;
+            Histogram* next = nullptr;
+
+            void Add(const uint64_t& ticks)
+            {
+                Increment(buckets[GetBucketIndex(ticks)], 1);
+                Increment(sum, ticks);
+
+                //Report resets max with an exchange, so a plain store could bring back a reported value or lose a new one
+                uint64_t current = max.load(std::memory_order_relaxed);
+                while(ticks > current && !max.compare_exchange_weak(current, ticks, std::memory_order_relaxed)) {}
+            }
+
+        private:
+            //there is only one writer, so it doesn't need a locked instruction
+            static void Increment(std::atomic<uint64_t>& value, const uint64_t& addend)
+            {
+                value.store(value.load(std::memory_order_relaxed) + addend, std::memory_order_relaxed);
+            }
+        };
+
+        /**
+         * \brief Measures the time between its construction and destruction. Use GE_PROFILE_SCOPE instead.
+         */
+        class Scope final
+        {
+        public:
+            explicit Scope(const uint32_t& scopeId)
+                : scopeId(scopeId), begin(scopeId != 0 ? GetTicks() : 0) {}
+            ~Scope()
+            {
+                if(scopeId != 0)
+                    Record(scopeId, GetTicks() - begin);
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            uint32_t scopeId;
+            uint64_t begin;
+        };
+
+    public:
+        Profiler() = delete;
+        ~Profiler() = delete;
+
+        /**
+         * \brief Starts a thread, which calls Report every interval. Does nothing if it is already started.
+         */
+        static void Start(const std::chrono::milliseconds& interval = std::chrono::seconds{ 10 });
+        /**
+         * \brief Stops the reporting thread and reports the rest. At exit the thread is only stopped, the sinks may be gone by then,
+         * so call Stop before the end of main to get the last report.
+         */
+        static void Stop();
+        /**
+         * \brief Writes the summary line of every scope, which was entered since the previous report.
+         */
+        static void Report();
+
+        /**
+         * \return Cheap monotonic time: TSC on x86, std::chrono::steady_clock in nanoseconds otherwise.
+         */
+        [[nodiscard]]
+        static uint64_t GetTicks()
+        {
+#ifdef GE_PROFILER_TSC
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        [[nodiscard]]
+        static constexpr size_t GetBucketIndex(const uint64_t& ticks)
+        {
+            constexpr size_t subBucketsBits = std::bit_width(subBucketsCount) - 1;
+
+            if(ticks < subBucketsCount)
+                return static_cast<size_t>(ticks);
+
+            const size_t exponent = std::bit_width(ticks) - 1;
+            const size_t subBucket = static_cast<size_t>(ticks >> (exponent - subBucketsBits)) & (subBucketsCount - 1);
+
+            return (exponent - subBucketsBits + 1) * subBucketsCount + subBucket;
+        }
+        /**
+         * \return The middle of the bucket's range.
+         */
+        [[nodiscard]]
+        static constexpr uint64_t GetBucketValue(const size_t& index)
+        {
+            if(index < subBucketsCount)
+                return index;
+
+            const size_t shift = index / subBucketsCount - 1;
+            const uint64_t lowest = static_cast<uint64_t>(subBucketsCount + index % subBucketsCount) << shift;
+
+            return lowest + ((uint64_t{ 1 } << shift) >> 1);
+        }
+
+        /**
+         * \return Id of the call site, which is registered on the first call, 0 if the category is disabled. Use GE_PROFILE_SCOPE instead.
+         * \tparam CallSiteTag Unique type of every call site.
+         */
+        template<typename Category, typename CallSiteTag>
+        [[nodiscard]]
+        static uint32_t GetScopeId(const Category& category, const std::string_view& name, const CallSiteTag&)
+        {
+            if constexpr(!Category::enable || !Category::CanSupportLogLevel(LogLevel::Info) || LogLevel::Info < minLogLevel)
+                return 0;
+            else
+            {
+                static const uint32_t scopeId = RegisterScope(name, &category, WriteSummary<Category>);
+                return scopeId;
+            }
+        }
+
+    private:
+        using SummaryWriter = void(*)(const void* category, const std::string_view& summary);
+
+        struct ThreadHistograms final
+        {
+            ~ThreadHistograms();
+
+            //indexed by scope id
+            std::vector<Histogram*> histograms;
+        };
+
+    private:
+        static inline thread_local ThreadHistograms threadHistograms;
+
+    private:
+        static void Record(const uint32_t& scopeId, const uint64_t& ticks)
+        {
+            const auto& histograms = threadHistograms.histograms;
+
+            Histogram* histogram = scopeId < histograms.size() ? histograms[scopeId] : nullptr;
+
+            if(!histogram) [[unlikely]]
+                histogram = AcquireHistogram(scopeId);
+
+            histogram->Add(ticks);
+        }
+
+        /**
+         * \brief Takes a histogram of the scope left by a finished thread or creates a new one.
+         */
+        GE_COLD static Histogram* AcquireHistogram(const uint32_t& scopeId);
+        static uint32_t RegisterScope(const std::string_view& name, const void* category, const SummaryWriter& writeSummary);
+
+        template<typename Category>
+        static void WriteSummary(const void* category, const std::string_view& summary)
+        {
+            Logger::Log<LogLevel::Info>(*static_cast<const Category*>(category), summary);
+        }
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <new>
+
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Bounded lock-free queue for many producers and one consumer(D. Vyukov's algorithm).
+     * Every cell has its own sequence number, so producers contend only on one CAS of the enqueue position
+     * and never wait for each other, the consumer doesn't touch any shared counter except its own.
+     * \tparam T Type of stored values, must be default constructible and swappable.
+     */
+    template<typename T>
+    class BoundedMPSCQueue final
+    {
+    public:
+        /**
+         * \param capacity Max count of values inside the queue, is rounded up to a power of two.
+         */
+        explicit BoundedMPSCQueue(const size_t& capacity)
+            : capacity(RoundUpToPowerOfTwo(capacity)), mask(this->capacity - 1), cells(std::make_unique<Cell[]>(this->capacity))
+        {
+            for(size_t i = 0; i < this->capacity; ++i)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+        BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+        /**
+         * \brief Can be called from any thread. The value is assigned to a free cell(so the cell may reuse its own memory), nothing happens if there is none.
+         * \return false if the queue is full.
+         */
+        template<typename U>
+        bool TryPush(U&& value)
+        {
+            Cell* cell;
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+            while(true)
+            {
+                cell = &cells[position & mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                if(difference == 0)
+                {
+                    if(enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if(difference < 0)
+                    return false;
+                else
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+
+            cell->value = std::forward<U>(value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            return true;
+        }
+        /**
+         * \brief Must be called only from one thread at a time. The value is swapped with the cell's one, so memory of both circulates instead of being freed.
+         * \return false if the queue is empty.
+         */
+        bool TryPop(T& value)
+        {
+            const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            Cell& cell = cells[position & mask];
+
+            if(cell.sequence.load(std::memory_order_acquire) != position + 1)
+                return false;
+
+            using std::swap;
+            swap(value, cell.value);
+            cell.sequence.store(position + capacity, std::memory_order_release);
+            dequeuePosition.store(position + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        /**
+         * \brief Must be called only from the consumer thread.
+         */
+        [[nodiscard]]
+        bool IsEmpty() const
+        {
+            const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            return cells[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+        }
+
+        /**
+         * \return Count of values, which were pushed(or are being pushed right now) since the creation of the queue.
+         */
+        [[nodiscard]]
+        uint64_t GetEnqueuedCount() const
+        {
+            return enqueuePosition.load(std::memory_order_acquire);
+        }
+        /**
+         * \return Approximate count of values inside the queue, can be called from any thread.
+         */
+        [[nodiscard]]
+        size_t GetApproximateSize() const
+        {
+            const size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+            const size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+        [[nodiscard]]
+        size_t GetCapacity() const
+        {
+            return capacity;
+        }
+
+    private:
+        static constexpr size_t cacheLineSize = 64;
+
+        struct alignas(cacheLineSize) Cell final
+        {
+            std::atomic<size_t> sequence{};
+            T value{};
+        };
+
+        static size_t RoundUpToPowerOfTwo(const size_t& value)
+        {
+            size_t result = 2;
+            while(result < value)
+                result <<= 1;
+            return result;
+        }
+
+    private:
+        const size_t capacity;
+        const size_t mask;
+        std::unique_ptr<Cell[]> cells;
+
+        alignas(cacheLineSize) std::atomic<size_t> enqueuePosition{ 0 };
+        alignas(cacheLineSize) std::atomic<size_t> dequeuePosition{ 0 };
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "GuelderConsoleLogSinks.hpp"
+#include "GuelderConsoleLogMappedFile.hpp"
+
+#include <filesystem>
+
+//shared memory ring format
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Layout of a ring file written by SharedMemorySink and read by GuelderConsoleLogCollector: RingHeader, then capacity bytes of records.
+     * Record: line size(uint32_t), LogLevel(uint8_t), 3 bytes of padding, time in nanoseconds since the epoch(int64_t), line; every record starts at a multiple of 8.
+     * If wrapMarker is written instead of the size, the rest of the ring is skipped. Numbers are stored in the byte order of the writing machine.
+     */
+    namespace SharedMemoryFormat
+    {
+        constexpr char magic[8] = { 'G', 'E', 'S', 'H', 'R', 'I', 'N', 'G' };
+        constexpr uint32_t version = 1;
+
+        constexpr uint32_t wrapMarker = UINT32_MAX;
+        constexpr size_t recordHeaderSize = 16;
+        constexpr size_t recordAlignment = 8;
+
+        //files are named "channel.processId.startTime.ring"
+        constexpr std::string_view fileExtension = ".ring";
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "atomics inside shared memory must be lock-free");
+
+        struct RingHeader final
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t headerSize;
+            //power of two
+            uint64_t capacity;
+            int64_t processId;
+
+            //the producer has finished, the file is removed after the rest is read
+            std::atomic<uint32_t> closed;
+            std::atomic<uint64_t> droppedCount;
+
+            //bytes written by the producer
+            alignas(64) std::atomic<uint64_t> head;
+            //bytes read by the collector
+            alignas(64) std::atomic<uint64_t> tail;
+        };
+
+        [[nodiscard]]
+        constexpr uint64_t GetRecordSize(const uint64_t& lineSize)
+        {
+            return (recordHeaderSize + lineSize + recordAlignment - 1) / recordAlignment * recordAlignment;
+        }
+    }
+}
+
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Writes records into a ring inside a file in shared memory(/dev/shm on Linux), one ring per process.
+     * GuelderConsoleLogCollector reads the rings of all the processes of the channel and writes their lines merged by time.
+     * Write never makes a system call: if the ring is full, the record is dropped and counted.
+     */
+    class SharedMemorySink final : public Sink
+    {
+    public:
+        struct Options final
+        {
+            //GuelderConsoleLogCollector must be given the same directory and channel
+            std::filesystem::path directory = GetDefaultDirectory();
+            std::string channel = "GuelderConsoleLog";
+            //is rounded up to a power of two, a record must be smaller than a half of it
+            size_t capacity = 4 << 20;
+        };
+
+    public:
+        explicit SharedMemorySink(const Options& options);
+        SharedMemorySink();
+        ~SharedMemorySink() override;
+
+        void Write(const LogRecord& record) override;
+
+        /**
+         * \return Count of records, which didn't fit into the ring.
+         */
+        [[nodiscard]]
+        uint64_t GetDroppedCount() const;
+        [[nodiscard]]
+        const std::filesystem::path& GetPath() const;
+
+        /**
+         * \return /dev/shm if it exists, the temporary directory otherwise.
+         */
+        [[nodiscard]]
+        static std::filesystem::path GetDefaultDirectory();
+
+    private:
+        std::filesystem::path path;
+        std::unique_ptr<MappedFile> file;
+
+        SharedMemoryFormat::RingHeader* header = nullptr;
+        char* data = nullptr;
+        uint64_t capacity = 0;
+
+        //the last read tail, the real one is read only when this one says the ring is full
+        uint64_t cachedTail = 0;
+
+        //colored lines are copied here without colors
+        std::string uncolored;
+    };
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "GuelderConsoleLog.hpp"
+
+#include <filesystem>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Destination of log records. Logger calls Write and Flush under its own mutex, so a sink doesn't have to be thread-safe for them.
+     */
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        virtual void Write(const LogRecord& record) = 0;
+        /**
+         * \brief Must return only when everything written before is handed to the operating system.
+         */
+        virtual void Flush() {}
+    };
+
+    /**
+     * \brief Appends the line to out without ANSI SGR sequences("\x1b[...m").
+     */
+    void AppendWithoutColors(std::string& out, const std::string_view& line);
+
+    /**
+     * \brief Writes lines to the standard output. By default every line is written with one system call,
+     * with Options lines are gathered into batches, each batch is written with one writev.
+     */
+    class ConsoleSink final : public Sink
+    {
+    public:
+        /**
+         * \brief A batch is written as soon as it reaches any of the limits.
+         */
+        struct Options final
+        {
+            size_t maxBatchBytes = 64 << 10;
+            size_t maxBatchRecords = 1024;
+            //how long a line may wait in a batch, is kept by a background thread
+            std::chrono::milliseconds maxBatchDelay{ 100 };
+            //records of this level and above are written at once together with the batch, LogLevel::All - never
+            LogLevel flushLevel = LogLevel::Error;
+        };
+
+    public:
+        ConsoleSink() = default;
+        explicit ConsoleSink(const Options& options);
+        ~ConsoleSink() override;
+
+        ConsoleSink(const ConsoleSink&) = delete;
+        ConsoleSink& operator=(const ConsoleSink&) = delete;
+
+        void Write(const LogRecord& record) override;
+        void Flush() override;
+
+    private:
+        /**
+         * \brief Writes the batch and then the line(may be empty) with one system call. batchMutex must be locked.
+         */
+        void WriteBatch(const std::string_view& line = {});
+        void RunFlusher();
+
+    private:
+        //maxBatchRecords == 1 - no batching
+        const Options options{ .maxBatchRecords = 1 };
+
+        //guards batch, batchRecords, batchTime and stopRequested
+        std::mutex batchMutex;
+        std::condition_variable batchStarted;
+        std::string batch;
+        size_t batchRecords = 0;
+        //when the first line of the batch was added
+        std::chrono::steady_clock::time_point batchTime;
+        bool stopRequested = false;
+
+        std::thread flusher;
+    };
+
+    /**
+     * \brief Copies lines into large aligned buffers, full buffers are written and files are rotated by a background thread,
+     * so a logging thread waits only if the disk can't keep up with all the buffers.
+     */
+    class FileSink final : public Sink
+    {
+    public:
+        struct Options final
+        {
+            std::filesystem::path path;
+
+            size_t bufferSize = 1 << 20;
+            //at least 2: one is filled while the others are being written
+            size_t buffersCount = 4;
+            //how long a partially filled buffer may wait before being written
+            std::chrono::milliseconds flushInterval{ 1000 };
+            //Write returns only after records of this level and above are written to the file, LogLevel::All - never
+            LogLevel flushLevel = LogLevel::Error;
+
+            //0 - no rotation by size
+            uint64_t maxFileSize = 0;
+            //0 - no rotation by time, otherwise files are rotated at multiples of the interval since the epoch(e.g. 24h - at UTC midnight)
+            std::chrono::seconds rotationInterval{ 0 };
+            //rotated files are named path.1(the newest), path.2, ..., the older ones are removed
+            size_t maxBackupCount = 5;
+
+            //every buffer of whole lines is compressed by the writing thread into an independent frame(GuelderConsoleLogCompression.hpp),
+            //GuelderConsoleLogDecompressor turns the file back into text. maxFileSize counts uncompressed bytes
+            bool compress = false;
+        };
+
+    public:
+        explicit FileSink(const Options& options);
+        explicit FileSink(const std::filesystem::path& path);
+        ~FileSink() override;
+
+        FileSink(const FileSink&) = delete;
+        FileSink& operator=(const FileSink&) = delete;
+
+        void Write(const LogRecord& record) override;
+        void Flush() override;
+
+    private:
+        static constexpr size_t bufferAlignment = 4096;
+
+        struct AlignedDeleter final
+        {
+            void operator()(char* data) const
+            {
+                ::operator delete[](data, std::align_val_t{ bufferAlignment });
+            }
+        };
+
+        struct Buffer final
+        {
+            std::unique_ptr<char[], AlignedDeleter> data;
+            size_t size = 0;
+            //the file is rotated after this buffer is written
+            bool rotateAfter = false;
+
+            //of the records, whose lines end in the buffer, are written into the header of its compressed frame
+            uint32_t recordsCount = 0;
+            std::chrono::system_clock::time_point minTime = std::chrono::system_clock::time_point::max();
+            std::chrono::system_clock::time_point maxTime = std::chrono::system_clock::time_point::min();
+        };
+
+    private:
+        void WriteToBuffer(const LogRecord& record);
+        void Append(const std::string_view& bytes);
+        /**
+         * \brief Hands the active buffer to the writing thread and takes a free one. bufferMutex must be locked.
+         */
+        void SubmitActiveBuffer();
+        void RunWriter();
+        void WriteFrame(const Buffer& buffer);
+
+        void OpenFile();
+        void RotateFile();
+
+        [[nodiscard]]
+        std::chrono::system_clock::time_point GetNextRotationTime(const std::chrono::system_clock::time_point& time) const;
+
+    private:
+        const Options options;
+
+        //guards active, fileSize and nextRotationTime
+        std::mutex bufferMutex;
+        Buffer active;
+        uint64_t fileSize = 0;
+        std::chrono::system_clock::time_point nextRotationTime;
+
+        //guards freeBuffers, pendingBuffers, submittedCount, writtenCount and stopRequested
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<Buffer> freeBuffers;
+        std::deque<Buffer> pendingBuffers;
+        uint64_t submittedCount = 0;
+        uint64_t writtenCount = 0;
+        bool stopRequested = false;
+
+        //colored lines are copied here without colors, guarded by bufferMutex
+        std::string uncolored;
+
+        //used only by the writing thread(and by the constructor before it starts)
+        std::FILE* file = nullptr;
+        std::vector<char> compressed;
+
+        std::thread writer;
+    };
+}
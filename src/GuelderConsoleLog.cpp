@@ -1,20 +1,1269 @@
 #include "../include/GuelderConsoleLog.hpp"
+#include "../include/GuelderConsoleLogSinks.hpp"
 
 #include <mutex>
+#include <thread>
+#include <memory>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <csignal>
+#include <cstring>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace GuelderConsoleLog
 {
+    namespace
+    {
+        struct SinksRegistry final
+        {
+            std::vector<std::shared_ptr<Sink>> defaultSinks{ std::make_shared<ConsoleSink>() };
+            //categories, which have ever had their own sinks
+            std::vector<CategoryState*> categories;
+        };
+
+        //guarded by Logger::logMutex
+        SinksRegistry& GetSinksRegistry()
+        {
+            static SinksRegistry registry;
+            return registry;
+        }
+
+        struct LevelsRegistry final
+        {
+            //every category, which was used with GE_LOG
+            std::vector<CategoryState*> categories;
+            //levels set by name before such a category was registered
+            std::vector<std::pair<std::string, LogLevel>> pendingLevels;
+        };
+
+        //guarded by Logger::logMutex, categories are registered during static initialization
+        LevelsRegistry& GetLevelsRegistry()
+        {
+            static LevelsRegistry registry;
+            return registry;
+        }
+    }
+
+    struct Logger::AsyncBackend final
+    {
+        //is made by the first StartAsync and is never replaced: a thread, which saw the asynchronous mode on, may still be pushing into it after StopAsync
+        std::atomic<BoundedMPSCQueue<AsyncRecord>*> queue = nullptr;
+        std::atomic<AsyncOverflowPolicy> overflowPolicy = AsyncOverflowPolicy::Block;
+
+        std::thread worker;
+        std::atomic<std::thread::id> workerId{};
+
+        std::atomic<bool> stopRequested = false;
+        std::atomic<bool> workerSleeping = false;
+
+        //count of records, which were taken from the queue and written
+        std::atomic<uint64_t> writtenCount = 0;
+        std::atomic<uint64_t> droppedCount = 0;
+
+        //serializes StartAsync and StopAsync
+        std::mutex controlMutex;
+
+        ~AsyncBackend()
+        {
+            delete queue.load();
+        }
+    };
+
     std::mutex Logger::logMutex;
 #ifdef WIN32
     HANDLE Logger::console = GetStdHandle(STD_OUTPUT_HANDLE);
 #endif
+    bool Logger::colorsEnabled = false;
+    std::atomic<uint32_t> Logger::timestampFormat = 0;
+    std::atomic<bool> Logger::asyncEnabled = false;
+    Logger::AsyncBackend Logger::asyncBackend{};
+
+    //must be defined after asyncBackend, so it is destroyed before it
     const Logger::LoggerHelper Logger::loggerHelper = LoggerHelper{};
 
     Logger::LoggerHelper::LoggerHelper()
     {
+        //the registry must be created before the helper, so it is destroyed after the last records are written
+        GetSinksRegistry();
+
         std::setlocale(LC_CTYPE, GE_LOCALE);
+        //https://no-color.org
+        const char* noColor = std::getenv("NO_COLOR");
+        const bool colorsAllowed = noColor == nullptr || noColor[0] == '\0';
+
 #ifdef WIN32
         SetConsoleOutputCP(CP_UTF8);
+
+        //colors are written inside the line as ANSI sequences, GetConsoleMode fails if the output is redirected
+        DWORD mode = 0;
+        if(colorsAllowed && GetConsoleMode(console, &mode))
+            colorsEnabled = SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+        const char* terminal = std::getenv("TERM");
+        colorsEnabled = colorsAllowed && isatty(STDOUT_FILENO) && !(terminal && std::string_view{ terminal } == "dumb");
 #endif
     }
-}
\ No newline at end of file
+    Logger::LoggerHelper::~LoggerHelper()
+    {
+        StopAsync();
+        Flush();
+    }
+}
+
+//sinks
+namespace GuelderConsoleLog
+{
+    void Logger::SetDefaultSinks(const std::vector<std::shared_ptr<Sink>>& sinks)
+    {
+        std::lock_guard lock{ logMutex };
+        GetSinksRegistry().defaultSinks = sinks;
+    }
+    void Logger::AddDefaultSink(const std::shared_ptr<Sink>& sink)
+    {
+        std::lock_guard lock{ logMutex };
+        GetSinksRegistry().defaultSinks.push_back(sink);
+    }
+    void Logger::AddSink(CategoryState* category, const std::shared_ptr<Sink>& sink)
+    {
+        Assert(category != nullptr, "Logger::AddSink: the category must be declared with GE_DECLARE_LOG_CATEGORY_CONSTEXPR", __FILE__, __LINE__);
+
+        std::lock_guard lock{ logMutex };
+
+        auto& categories = GetSinksRegistry().categories;
+        if(std::find(categories.begin(), categories.end(), category) == categories.end())
+            categories.push_back(category);
+
+        category->sinks.push_back(sink);
+    }
+    void Logger::RemoveSinks(CategoryState* category)
+    {
+        if(!category)
+            return;
+
+        std::lock_guard lock{ logMutex };
+        category->sinks.clear();
+    }
+    void Logger::Dispatch(const LogRecord& record)
+    {
+        const auto& sinks = record.category && !record.category->sinks.empty() ? record.category->sinks : GetSinksRegistry().defaultSinks;
+
+        const WriterScope writerScope;
+
+        for(const auto& sink : sinks)
+            sink->Write(record);
+    }
+}
+
+//levels
+namespace GuelderConsoleLog
+{
+    void Logger::SetLogLevel(const std::string_view& categoryName, const LogLevel& minLevel)
+    {
+        std::lock_guard lock{ logMutex };
+
+        auto& registry = GetLevelsRegistry();
+
+        for(const auto& category : registry.categories)
+            if(category->name == categoryName)
+                category->minLevel.store(static_cast<uint8_t>(minLevel), std::memory_order_relaxed);
+
+        const auto found = std::find_if(registry.pendingLevels.begin(), registry.pendingLevels.end(), [&categoryName](const auto& pending) { return pending.first == categoryName; });
+
+        if(found != registry.pendingLevels.end())
+            found->second = minLevel;
+        else
+            registry.pendingLevels.emplace_back(categoryName, minLevel);
+    }
+    void Logger::SetAllLogLevels(const LogLevel& minLevel)
+    {
+        std::lock_guard lock{ logMutex };
+
+        auto& registry = GetLevelsRegistry();
+
+        for(const auto& category : registry.categories)
+            category->minLevel.store(static_cast<uint8_t>(minLevel), std::memory_order_relaxed);
+
+        registry.pendingLevels.clear();
+    }
+    std::vector<std::string_view> Logger::GetCategoryNames()
+    {
+        std::lock_guard lock{ logMutex };
+
+        std::vector<std::string_view> names;
+        for(const auto& category : GetLevelsRegistry().categories)
+            names.push_back(category->name);
+
+        return names;
+    }
+    bool Logger::RegisterCategory(CategoryState* category)
+    {
+        std::lock_guard lock{ logMutex };
+
+        auto& registry = GetLevelsRegistry();
+
+        registry.categories.push_back(category);
+        category->metricsId.store(static_cast<uint32_t>(registry.categories.size()), std::memory_order_relaxed);
+
+        for(const auto& [name, minLevel] : registry.pendingLevels)
+            if(name == category->name)
+                category->minLevel.store(static_cast<uint8_t>(minLevel), std::memory_order_relaxed);
+
+        return true;
+    }
+}
+
+//timestamps
+namespace GuelderConsoleLog
+{
+    void Logger::SetTimestampFormat(const TimestampPrecision& precision, const TimestampZone& zone)
+    {
+        timestampFormat.store((static_cast<uint32_t>(zone) << 8) | static_cast<uint32_t>(precision), std::memory_order_relaxed);
+    }
+    TimestampPrecision Logger::GetTimestampPrecision()
+    {
+        return static_cast<TimestampPrecision>(timestampFormat.load(std::memory_order_relaxed) & 0xFF);
+    }
+    TimestampZone Logger::GetTimestampZone()
+    {
+        return static_cast<TimestampZone>((timestampFormat.load(std::memory_order_relaxed) >> 8) & 0xFF);
+    }
+}
+
+//async mode
+namespace GuelderConsoleLog
+{
+    void Logger::StartAsync(const size_t& queueCapacity, const AsyncOverflowPolicy& overflowPolicy)
+    {
+        std::lock_guard controlLock{ asyncBackend.controlMutex };
+
+        if(asyncEnabled.load())
+            return;
+
+        {
+            std::lock_guard lock{ logMutex };
+
+            //the queue may still have records, which were pushed during StopAsync
+            if(asyncBackend.queue.load())
+                DrainAsyncQueue();
+            else
+                asyncBackend.queue.store(new BoundedMPSCQueue<AsyncRecord>{ queueCapacity });
+        }
+
+        asyncBackend.overflowPolicy.store(overflowPolicy);
+        asyncBackend.stopRequested.store(false);
+        asyncBackend.workerSleeping.store(false);
+        asyncBackend.worker = std::thread{ RunAsyncWorker };
+        asyncBackend.workerId.store(asyncBackend.worker.get_id());
+
+        asyncEnabled.store(true);
+    }
+    void Logger::StopAsync()
+    {
+        std::lock_guard controlLock{ asyncBackend.controlMutex };
+
+        if(!asyncEnabled.load())
+            return;
+
+        //new records go the synchronous way from now on, those which are being pushed right now are written either by the worker or by the pushing thread
+        asyncEnabled.store(false);
+
+        asyncBackend.stopRequested.store(true);
+        WakeAsyncWorker();
+        asyncBackend.worker.join();
+        asyncBackend.workerId.store({});
+    }
+    void Logger::Flush()
+    {
+        if(asyncEnabled.load() && asyncBackend.workerId.load() != std::this_thread::get_id())
+        {
+            const uint64_t target = asyncBackend.queue.load()->GetEnqueuedCount();
+
+            WakeAsyncWorker();
+
+            uint64_t written = asyncBackend.writtenCount.load(std::memory_order_acquire);
+            while(written < target)
+            {
+                asyncBackend.writtenCount.wait(written, std::memory_order_acquire);
+                written = asyncBackend.writtenCount.load(std::memory_order_acquire);
+            }
+        }
+
+        std::lock_guard lock{ logMutex };
+        const WriterScope writerScope;
+
+        auto& registry = GetSinksRegistry();
+
+        for(const auto& sink : registry.defaultSinks)
+            sink->Flush();
+        for(const auto& category : registry.categories)
+            for(const auto& sink : category->sinks)
+                sink->Flush();
+    }
+    bool Logger::IsAsync()
+    {
+        return asyncEnabled.load(std::memory_order_relaxed);
+    }
+    uint64_t Logger::GetAsyncDroppedCount()
+    {
+        return asyncBackend.droppedCount.load(std::memory_order_relaxed);
+    }
+
+    void Logger::PushAsync(const LogRecord& record)
+    {
+        auto& queue = *asyncBackend.queue.load(std::memory_order_acquire);
+
+        if(asyncBackend.overflowPolicy.load(std::memory_order_relaxed) == AsyncOverflowPolicy::Drop)
+        {
+            if(!queue.TryPush(record))
+            {
+                asyncBackend.droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        else
+        {
+            while(!queue.TryPush(record))
+            {
+                if(!asyncEnabled.load())
+                {
+                    std::lock_guard lock{ logMutex };
+                    DrainAsyncQueue();
+                }
+                else
+                {
+                    WakeAsyncWorker();
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        //pairs with the fence in RunAsyncWorker and with the store in StopAsync: either the worker sees the record or this thread sees that it must act
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if(!asyncEnabled.load(std::memory_order_relaxed))
+        {
+            std::lock_guard lock{ logMutex };
+            DrainAsyncQueue();
+        }
+        else if(asyncBackend.workerSleeping.load(std::memory_order_relaxed))
+            WakeAsyncWorker();
+    }
+    void Logger::WakeAsyncWorker()
+    {
+        if(asyncBackend.workerSleeping.exchange(false))
+            asyncBackend.workerSleeping.notify_one();
+    }
+    void Logger::RunAsyncWorker()
+    {
+        const WriterScope writerScope;
+
+        while(true)
+        {
+            size_t drainedCount;
+            {
+                std::lock_guard lock{ logMutex };
+                drainedCount = DrainAsyncQueue();
+            }
+
+            if(drainedCount != 0)
+                continue;
+
+            if(asyncBackend.stopRequested.load())
+            {
+                std::lock_guard lock{ logMutex };
+                DrainAsyncQueue();
+                break;
+            }
+
+            asyncBackend.workerSleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if(!asyncBackend.queue.load()->IsEmpty() || asyncBackend.stopRequested.load())
+            {
+                asyncBackend.workerSleeping.store(false);
+                continue;
+            }
+
+            asyncBackend.workerSleeping.wait(true);
+        }
+    }
+    void Logger::OutputWithMetrics(const LogRecord& record)
+    {
+        Metrics::AddRecord(record.category, record.level, record.line.size());
+
+        //is empty if Metrics was enabled after the line had begun
+        if(record.formatBegin != std::chrono::steady_clock::time_point{})
+            Metrics::AddFormat(std::chrono::steady_clock::now() - record.formatBegin);
+
+        if(asyncEnabled.load(std::memory_order_acquire))
+        {
+            PushAsync(record);
+            return;
+        }
+
+        //metrics may be disabled meanwhile, then the lock is taken the usual way
+        if(!Metrics::IsEnabled())
+        {
+            if(LoadShedding::IsEnabled())
+                OutputWithLoadShedding(record);
+            else
+            {
+                std::lock_guard lock{ logMutex };
+                Dispatch(record);
+            }
+
+            return;
+        }
+
+        const auto lockBegin = std::chrono::steady_clock::now();
+        std::lock_guard lock{ logMutex };
+        const auto writeBegin = std::chrono::steady_clock::now();
+
+        Dispatch(record);
+
+        Metrics::AddLockWait(writeBegin - lockBegin);
+        Metrics::AddWrite(std::chrono::steady_clock::now() - writeBegin);
+
+        if(LoadShedding::IsEnabled())
+            LoadShedding::AddLockSample(record.time, writeBegin - lockBegin);
+    }
+    void Logger::OutputWithLoadShedding(const LogRecord& record)
+    {
+        //the clock is read only when there is something to wait for
+        std::chrono::nanoseconds lockWait{};
+
+        if(!logMutex.try_lock())
+        {
+            const auto lockBegin = std::chrono::steady_clock::now();
+            logMutex.lock();
+            lockWait = std::chrono::steady_clock::now() - lockBegin;
+        }
+
+        std::lock_guard lock{ logMutex, std::adopt_lock };
+
+        Dispatch(record);
+
+        LoadShedding::AddLockSample(record.time, lockWait);
+    }
+    size_t Logger::DrainAsyncQueue()
+    {
+        auto& queue = *asyncBackend.queue.load();
+
+        size_t count = 0;
+        AsyncRecord record;
+
+        while(queue.TryPop(record))
+        {
+            const LogRecord logRecord{ record.line, record.categoryName, record.level, record.time, record.category, record.colored };
+
+            if(Metrics::IsEnabled())
+            {
+                const auto begin = std::chrono::steady_clock::now();
+                Dispatch(logRecord);
+                Metrics::AddWrite(std::chrono::steady_clock::now() - begin);
+            }
+            else
+                Dispatch(logRecord);
+
+            //the queue may never get empty under pressure, so it is measured while draining
+            if(count % 64 == 0 && LoadShedding::IsEnabled())
+            {
+                const uint64_t enqueued = queue.GetEnqueuedCount();
+                const uint64_t written = asyncBackend.writtenCount.load(std::memory_order_relaxed) + count;
+                const uint64_t depth = enqueued > written ? enqueued - written : 0;
+
+                LoadShedding::AddQueueSample(record.time, static_cast<double>(depth) / static_cast<double>(queue.GetCapacity()));
+            }
+
+            ++count;
+        }
+
+        if(count != 0)
+        {
+            asyncBackend.writtenCount.fetch_add(count, std::memory_order_release);
+            asyncBackend.writtenCount.notify_all();
+        }
+
+        return count;
+    }
+}
+
+//flight recorder
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief The last lines of one category written by one thread. Rings are never freed, so a signal handler can read them at any moment,
+     * a ring of a finished thread is reused by the next thread, which logs to the category.
+     */
+    struct FlightRecorder::Ring final
+    {
+        struct Slot final
+        {
+            //nanoseconds since the epoch, 0 while the slot is empty or being written
+            std::atomic<int64_t> time = 0;
+            uint32_t size = 0;
+            char text[maxLineSize];
+        };
+
+        Ring(CategoryState* category, const uint32_t& capacity)
+            : category(category), capacity(capacity), slots(std::make_unique<Slot[]>(capacity)) {}
+
+        CategoryState* const category;
+        const uint32_t capacity;
+        const std::unique_ptr<Slot[]> slots;
+
+        //index of the oldest slot, is written only by the owning thread
+        std::atomic<uint32_t> next = 0;
+        std::atomic<bool> owned = true;
+
+        //is used only by Dump
+        uint32_t dumpCursor = 0;
+        uint32_t dumpLeft = 0;
+
+        Ring* nextRing = nullptr;
+    };
+
+    namespace
+    {
+        std::atomic<bool> anyFlightRecorder = false;
+        std::atomic_flag dumping = ATOMIC_FLAG_INIT;
+
+        using SignalHandler = void(*)(int);
+
+        constexpr int fatalSignals[] =
+        {
+            SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifndef WIN32
+            SIGBUS
+#endif
+        };
+        SignalHandler previousHandlers[std::size(fatalSignals)] = {};
+
+        void WriteAll(const int& fileDescriptor, const char* data, size_t size)
+        {
+            while(size != 0)
+            {
+#ifdef WIN32
+                const auto written = _write(fileDescriptor, data, static_cast<unsigned int>(size));
+#else
+                const auto written = write(fileDescriptor, data, size);
+#endif
+                if(written <= 0)
+                    return;
+
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+
+        void OnFatalSignal(int signal)
+        {
+            FlightRecorder::Dump();
+
+            for(size_t i = 0; i < std::size(fatalSignals); ++i)
+                if(fatalSignals[i] == signal)
+                    std::signal(signal, previousHandlers[i] == SIG_ERR ? SIG_DFL : previousHandlers[i]);
+
+            std::raise(signal);
+        }
+    }
+
+    constinit std::atomic<FlightRecorder::Ring*> FlightRecorder::rings = nullptr;
+
+    void FlightRecorder::SetSize(CategoryState& category, const uint32_t& recordsCount)
+    {
+        category.flightRecorderSize.store(recordsCount, std::memory_order_relaxed);
+
+        if(recordsCount != 0 && !anyFlightRecorder.exchange(true))
+            for(size_t i = 0; i < std::size(fatalSignals); ++i)
+                previousHandlers[i] = std::signal(fatalSignals[i], OnFatalSignal);
+    }
+
+    void FlightRecorder::RecordToThreadRing(CategoryState& category, const uint32_t& recordsCount, const std::string_view& line, const std::chrono::system_clock::time_point& time)
+    {
+        struct ThreadRings final
+        {
+            ~ThreadRings()
+            {
+                for(const auto& ring : list)
+                    ring->owned.store(false, std::memory_order_release);
+            }
+
+            std::vector<Ring*> list;
+        };
+        thread_local ThreadRings threadRings;
+
+        auto found = std::find_if(threadRings.list.begin(), threadRings.list.end(), [&category](const Ring* ring) { return ring->category == &category; });
+
+        //the size was changed, the old ring is left to other threads
+        if(found != threadRings.list.end() && (*found)->capacity != recordsCount)
+        {
+            (*found)->owned.store(false, std::memory_order_release);
+            threadRings.list.erase(found);
+            found = threadRings.list.end();
+        }
+
+        if(found == threadRings.list.end())
+        {
+            Ring* ring = nullptr;
+
+            for(Ring* current = rings.load(std::memory_order_acquire); current; current = current->nextRing)
+            {
+                bool owned = false;
+                if(current->category == &category && current->capacity == recordsCount && current->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+                {
+                    ring = current;
+                    break;
+                }
+            }
+
+            if(!ring)
+            {
+                ring = new Ring{ &category, recordsCount };
+
+                ring->nextRing = rings.load(std::memory_order_relaxed);
+                while(!rings.compare_exchange_weak(ring->nextRing, ring, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            threadRings.list.push_back(ring);
+            found = threadRings.list.end() - 1;
+        }
+
+        Ring& ring = **found;
+
+        const uint32_t index = ring.next.load(std::memory_order_relaxed);
+        ring.next.store(index + 1 == ring.capacity ? 0 : index + 1, std::memory_order_relaxed);
+
+        auto& slot = ring.slots[index];
+
+        //seqlock: a reader, which sees the same time before and after copying the text, has a whole line
+        slot.time.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t size = std::min(line.size(), maxLineSize);
+        std::memcpy(slot.text, line.data(), size);
+        if(size < line.size())
+            slot.text[size - 1] = '\n';
+        slot.size = static_cast<uint32_t>(size);
+
+        const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        slot.time.store(nanoseconds != 0 ? nanoseconds : 1, std::memory_order_release);
+    }
+
+    void FlightRecorder::Dump(const int& fileDescriptor)
+    {
+        if(!anyFlightRecorder.load() || dumping.test_and_set(std::memory_order_acquire))
+            return;
+
+        Ring* const first = rings.load(std::memory_order_acquire);
+
+        for(Ring* ring = first; ring; ring = ring->nextRing)
+        {
+            ring->dumpCursor = ring->next.load(std::memory_order_relaxed);
+            ring->dumpLeft = ring->capacity;
+        }
+
+        constexpr std::string_view header = "---- GuelderConsoleLog flight recorder ----\n";
+        constexpr std::string_view footer = "---- end of flight recorder ----\n";
+        WriteAll(fileDescriptor, header.data(), header.size());
+
+        //merges the rings by time, each of them is already chronological
+        while(true)
+        {
+            Ring* oldest = nullptr;
+            int64_t oldestTime = 0;
+
+            for(Ring* ring = first; ring; ring = ring->nextRing)
+            {
+                //skips empty slots
+                while(ring->dumpLeft != 0 && ring->slots[ring->dumpCursor].time.load(std::memory_order_acquire) == 0)
+                {
+                    ring->dumpCursor = ring->dumpCursor + 1 == ring->capacity ? 0 : ring->dumpCursor + 1;
+                    --ring->dumpLeft;
+                }
+
+                if(ring->dumpLeft == 0)
+                    continue;
+
+                const int64_t time = ring->slots[ring->dumpCursor].time.load(std::memory_order_acquire);
+                if(!oldest || time < oldestTime)
+                {
+                    oldest = ring;
+                    oldestTime = time;
+                }
+            }
+
+            if(!oldest)
+                break;
+
+            auto& slot = oldest->slots[oldest->dumpCursor];
+
+            char text[maxLineSize];
+            const uint32_t size = std::min<uint32_t>(slot.size, maxLineSize);
+            std::memcpy(text, slot.text, size);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            int64_t expected = oldestTime;
+            //the line wasn't overwritten while it was copied, it is forgotten, so the next Dump doesn't write it again
+            if(slot.time.compare_exchange_strong(expected, 0, std::memory_order_relaxed))
+            {
+                //strips ANSI color sequences
+                size_t uncoloredSize = 0;
+                for(size_t i = 0; i < size; ++i)
+                {
+                    if(text[i] == '\x1b' && i + 1 < size && text[i + 1] == '[')
+                    {
+                        i += 2;
+                        while(i < size && text[i] != 'm')
+                            ++i;
+                    }
+                    else
+                        text[uncoloredSize++] = text[i];
+                }
+
+                WriteAll(fileDescriptor, text, uncoloredSize);
+            }
+
+            oldest->dumpCursor = oldest->dumpCursor + 1 == oldest->capacity ? 0 : oldest->dumpCursor + 1;
+            --oldest->dumpLeft;
+        }
+
+        WriteAll(fileDescriptor, footer.data(), footer.size());
+
+        dumping.clear(std::memory_order_release);
+    }
+    void FlightRecorder::DumpIfEnabled()
+    {
+        if(anyFlightRecorder.load(std::memory_order_relaxed))
+            Dump();
+    }
+}
+
+//metrics
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Counters of one thread, only the owning thread writes them. Shards are never freed, a shard of a finished thread is reused by the next one.
+     */
+    struct Metrics::Shard final
+    {
+        struct CategoryCounters final
+        {
+            std::atomic<uint64_t> records[5] = {};
+            std::atomic<uint64_t> bytes[5] = {};
+            std::atomic<uint64_t> suppressed = 0;
+        };
+
+        struct Histogram final
+        {
+            std::atomic<uint64_t> buckets[LatencyHistogram::bucketsCount] = {};
+            std::atomic<uint64_t> count = 0;
+            std::atomic<uint64_t> sum = 0;
+
+            void Add(const std::chrono::nanoseconds& duration)
+            {
+                const uint64_t nanoseconds = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+                //bucket i holds values up to 64 << i
+                const size_t index = nanoseconds == 0 ? 0 : std::min<size_t>(std::bit_width((nanoseconds - 1) >> 6), LatencyHistogram::bucketsCount - 1);
+
+                Increment(buckets[index], 1);
+                Increment(count, 1);
+                Increment(sum, nanoseconds);
+            }
+            void MergeInto(LatencyHistogram& histogram) const
+            {
+                for(size_t i = 0; i < LatencyHistogram::bucketsCount; ++i)
+                    histogram.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+
+                histogram.count += count.load(std::memory_order_relaxed);
+                histogram.sum += sum.load(std::memory_order_relaxed);
+            }
+        };
+
+        //categories are allocated by blocks, so a reader never sees a block moving
+        static constexpr size_t blockSize = 32;
+        static constexpr size_t maxBlocks = 64;
+
+        std::atomic<CategoryCounters*> blocks[maxBlocks] = {};
+
+        Histogram lockWait;
+        Histogram format;
+        Histogram write;
+
+        std::atomic<bool> owned = true;
+        Shard* next = nullptr;
+
+        //there is only one writer, so it doesn't need a locked instruction
+        static void Increment(std::atomic<uint64_t>& value, const uint64_t& addend)
+        {
+            value.store(value.load(std::memory_order_relaxed) + addend, std::memory_order_relaxed);
+        }
+
+        /**
+         * \param id Categories beyond the limit are counted as unregistered ones(0).
+         */
+        CategoryCounters& GetCategory(uint32_t id)
+        {
+            if(id >= blockSize * maxBlocks)
+                id = 0;
+
+            auto& block = blocks[id / blockSize];
+            CategoryCounters* counters = block.load(std::memory_order_relaxed);
+
+            if(!counters) [[unlikely]]
+            {
+                counters = new CategoryCounters[blockSize];
+                block.store(counters, std::memory_order_release);
+            }
+
+            return counters[id % blockSize];
+        }
+    };
+
+    namespace
+    {
+        void AppendPrometheusLabel(std::string& out, const std::string_view& value)
+        {
+            for(const char& c : value)
+            {
+                if(c == '\\' || c == '"')
+                    out.push_back('\\');
+
+                if(c == '\n')
+                    out.append("\\n");
+                else
+                    out.push_back(c);
+            }
+        }
+        void AppendPrometheusSeconds(std::string& out, const double& seconds)
+        {
+            char buffer[32];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), seconds, std::chars_format::general);
+            out.append(buffer, result.ptr);
+        }
+        void AppendPrometheusHistogram(std::string& out, const std::string_view& name, const std::string_view& help, const LatencyHistogram& histogram)
+        {
+            Logger::FormatTo(out, "# HELP guelder_console_log_", name, ' ', help, "\n# TYPE guelder_console_log_", name, " histogram\n");
+
+            uint64_t cumulative = 0;
+            for(size_t i = 0; i + 1 < LatencyHistogram::bucketsCount; ++i)
+            {
+                cumulative += histogram.buckets[i];
+
+                Logger::FormatTo(out, "guelder_console_log_", name, "_bucket{le=\"");
+                AppendPrometheusSeconds(out, static_cast<double>(LatencyHistogram::GetBucketBound(i)) * 1e-9);
+                Logger::FormatTo(out, "\"} ", cumulative, '\n');
+            }
+
+            Logger::FormatTo(out, "guelder_console_log_", name, "_bucket{le=\"+Inf\"} ", histogram.count, '\n');
+            Logger::FormatTo(out, "guelder_console_log_", name, "_sum ");
+            AppendPrometheusSeconds(out, static_cast<double>(histogram.sum) * 1e-9);
+            Logger::FormatTo(out, "\nguelder_console_log_", name, "_count ", histogram.count, '\n');
+        }
+    }
+
+    std::atomic<bool> Metrics::enabled = false;
+    constinit std::atomic<Metrics::Shard*> Metrics::shards = nullptr;
+
+    void Metrics::SetEnabled(const bool& enabled)
+    {
+        Metrics::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Metrics::AddSuppressed(const CategoryState& category, const uint64_t& count)
+    {
+        Shard::Increment(GetThreadShard().GetCategory(category.metricsId.load(std::memory_order_relaxed)).suppressed, count);
+    }
+    void Metrics::AddRecord(const CategoryState* category, const LogLevel& level, const size_t& bytes)
+    {
+        auto& counters = GetThreadShard().GetCategory(category ? category->metricsId.load(std::memory_order_relaxed) : 0);
+        const size_t levelIndex = std::min<size_t>(std::countr_zero(static_cast<uint32_t>(level)), 4);
+
+        Shard::Increment(counters.records[levelIndex], 1);
+        Shard::Increment(counters.bytes[levelIndex], bytes);
+    }
+    void Metrics::AddLockWait(const std::chrono::nanoseconds& duration)
+    {
+        GetThreadShard().lockWait.Add(duration);
+    }
+    void Metrics::AddFormat(const std::chrono::nanoseconds& duration)
+    {
+        GetThreadShard().format.Add(duration);
+    }
+    void Metrics::AddWrite(const std::chrono::nanoseconds& duration)
+    {
+        GetThreadShard().write.Add(duration);
+    }
+
+    Metrics::Shard& Metrics::GetThreadShard()
+    {
+        struct ThreadShard final
+        {
+            ~ThreadShard()
+            {
+                if(shard)
+                    shard->owned.store(false, std::memory_order_release);
+            }
+
+            Shard* shard = nullptr;
+        };
+        thread_local ThreadShard threadShard;
+
+        if(threadShard.shard) [[likely]]
+            return *threadShard.shard;
+
+        for(Shard* current = shards.load(std::memory_order_acquire); current; current = current->next)
+        {
+            bool owned = false;
+            if(current->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+            {
+                threadShard.shard = current;
+                return *current;
+            }
+        }
+
+        Shard* shard = new Shard{};
+        shard->next = shards.load(std::memory_order_relaxed);
+        while(!shards.compare_exchange_weak(shard->next, shard, std::memory_order_release, std::memory_order_relaxed));
+
+        threadShard.shard = shard;
+        return *shard;
+    }
+
+    MetricsSnapshot Metrics::GetSnapshot()
+    {
+        MetricsSnapshot snapshot;
+
+        {
+            std::lock_guard lock{ Logger::logMutex };
+
+            //index is the metrics id, 0 - unregistered categories
+            snapshot.categories.resize(GetLevelsRegistry().categories.size() + 1);
+            for(size_t i = 0; i < GetLevelsRegistry().categories.size(); ++i)
+                snapshot.categories[i + 1].name = GetLevelsRegistry().categories[i]->name;
+        }
+
+        for(const Shard* shard = shards.load(std::memory_order_acquire); shard; shard = shard->next)
+        {
+            for(size_t id = 0; id < snapshot.categories.size() && id < Shard::blockSize * Shard::maxBlocks; ++id)
+            {
+                const Shard::CategoryCounters* block = shard->blocks[id / Shard::blockSize].load(std::memory_order_acquire);
+                if(!block)
+                    continue;
+
+                const auto& counters = block[id % Shard::blockSize];
+                auto& category = snapshot.categories[id];
+
+                for(size_t level = 0; level < category.records.size(); ++level)
+                {
+                    category.records[level] += counters.records[level].load(std::memory_order_relaxed);
+                    category.bytes[level] += counters.bytes[level].load(std::memory_order_relaxed);
+                }
+                category.suppressed += counters.suppressed.load(std::memory_order_relaxed);
+            }
+
+            shard->lockWait.MergeInto(snapshot.lockWait);
+            shard->format.MergeInto(snapshot.format);
+            shard->write.MergeInto(snapshot.write);
+        }
+
+        //unregistered categories are shown only if there are some
+        const auto& unregistered = snapshot.categories.front();
+        if(std::all_of(unregistered.records.begin(), unregistered.records.end(), [](const uint64_t& count) { return count == 0; }) && unregistered.suppressed == 0)
+            snapshot.categories.erase(snapshot.categories.begin());
+
+        snapshot.async = Logger::asyncEnabled.load();
+        if(const auto queue = Logger::asyncBackend.queue.load())
+        {
+            const uint64_t enqueued = queue->GetEnqueuedCount();
+            const uint64_t written = Logger::asyncBackend.writtenCount.load();
+
+            snapshot.asyncQueueDepth = enqueued > written ? enqueued - written : 0;
+            snapshot.asyncQueueCapacity = queue->GetCapacity();
+        }
+        snapshot.asyncDroppedCount = Logger::asyncBackend.droppedCount.load(std::memory_order_relaxed);
+
+        return snapshot;
+    }
+
+    std::string Metrics::FormatPrometheus(const MetricsSnapshot& snapshot)
+    {
+        constexpr std::string_view levelNames[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+
+        std::string out;
+
+        const auto appendPerLevel = [&](const std::string_view& name, const std::string_view& help, const auto& getValues)
+            {
+                Logger::FormatTo(out, "# HELP guelder_console_log_", name, ' ', help, "\n# TYPE guelder_console_log_", name, " counter\n");
+
+                for(const auto& category : snapshot.categories)
+                {
+                    const auto& values = getValues(category);
+
+                    for(size_t level = 0; level < values.size(); ++level)
+                    {
+                        if(values[level] == 0)
+                            continue;
+
+                        Logger::FormatTo(out, "guelder_console_log_", name, "{category=\"");
+                        AppendPrometheusLabel(out, category.name);
+                        Logger::FormatTo(out, "\",level=\"", levelNames[level], "\"} ", values[level], '\n');
+                    }
+                }
+            };
+
+        appendPerLevel("records_total", "Records handed to the output.", [](const MetricsSnapshot::Category& category) -> const auto& { return category.records; });
+        appendPerLevel("bytes_total", "Bytes of the records handed to the output.", [](const MetricsSnapshot::Category& category) -> const auto& { return category.bytes; });
+
+        Logger::FormatTo(out, "# HELP guelder_console_log_suppressed_total Messages suppressed by the rate limiting macros.\n# TYPE guelder_console_log_suppressed_total counter\n");
+        for(const auto& category : snapshot.categories)
+        {
+            Logger::FormatTo(out, "guelder_console_log_suppressed_total{category=\"");
+            AppendPrometheusLabel(out, category.name);
+            Logger::FormatTo(out, "\"} ", category.suppressed, '\n');
+        }
+
+        AppendPrometheusHistogram(out, "lock_wait_seconds", "Time spent waiting for the logger mutex.", snapshot.lockWait);
+        AppendPrometheusHistogram(out, "format_seconds", "Time spent making a line.", snapshot.format);
+        AppendPrometheusHistogram(out, "write_seconds", "Time spent in the sinks.", snapshot.write);
+
+        Logger::FormatTo(out,
+            "# HELP guelder_console_log_async_queue_depth Records waiting in the asynchronous queue.\n# TYPE guelder_console_log_async_queue_depth gauge\n",
+            "guelder_console_log_async_queue_depth ", snapshot.asyncQueueDepth, '\n',
+            "# HELP guelder_console_log_async_queue_capacity Capacity of the asynchronous queue.\n# TYPE guelder_console_log_async_queue_capacity gauge\n",
+            "guelder_console_log_async_queue_capacity ", snapshot.asyncQueueCapacity, '\n',
+            "# HELP guelder_console_log_async_dropped_total Records dropped because the asynchronous queue was full.\n# TYPE guelder_console_log_async_dropped_total counter\n",
+            "guelder_console_log_async_dropped_total ", snapshot.asyncDroppedCount, '\n');
+
+        return out;
+    }
+
+    bool Metrics::ExportPrometheus(const std::filesystem::path& path)
+    {
+        const std::string text = FormatPrometheus(GetSnapshot());
+
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+
+#ifdef WIN32
+        std::FILE* file = _wfopen(temporaryPath.c_str(), L"wb");
+#else
+        std::FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+#endif
+        if(!file)
+            return false;
+
+        const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+
+        if(std::fclose(file) != 0 || !written)
+            return false;
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+
+        return !error;
+    }
+    void Metrics::ExportPrometheus(const std::function<void(const std::string_view& text)>& callback)
+    {
+        callback(FormatPrometheus(GetSnapshot()));
+    }
+}
+
+//load shedding
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        //guarded by Logger::logMutex
+        struct SheddingMonitor final
+        {
+            LoadShedding::Options options;
+            //categories with a policy
+            std::vector<CategoryState*> categories;
+
+            std::chrono::system_clock::time_point windowBegin;
+            uint64_t recordsCount = 0;
+            std::chrono::nanoseconds lockWait{};
+            double maxQueueFill = 0;
+
+            //the last window, whose pressure wasn't lower than the current one
+            std::chrono::system_clock::time_point lastPressured;
+            std::chrono::system_clock::time_point sheddingBegin;
+        };
+
+        //policies are declared during static initialization
+        SheddingMonitor& GetSheddingMonitor()
+        {
+            static SheddingMonitor monitor;
+            return monitor;
+        }
+
+        constexpr size_t levelsCount = std::extent_v<decltype(CategoryState::shedCounts)>;
+    }
+
+    std::atomic<bool> LoadShedding::enabled = false;
+    std::atomic<Backpressure> LoadShedding::backpressure = Backpressure::None;
+
+    void LoadShedding::SetPolicy(CategoryState& category, const LogLevel& elevatedMinLevel, const LogLevel& highMinLevel)
+    {
+        std::lock_guard lock{ Logger::logMutex };
+
+        auto& monitor = GetSheddingMonitor();
+
+        //Error is never shed
+        category.sheddingPolicy[0] = std::min(static_cast<uint8_t>(elevatedMinLevel), static_cast<uint8_t>(LogLevel::Error));
+        category.sheddingPolicy[1] = std::min(static_cast<uint8_t>(highMinLevel), static_cast<uint8_t>(LogLevel::Error));
+
+        if(std::find(monitor.categories.begin(), monitor.categories.end(), &category) == monitor.categories.end())
+            monitor.categories.push_back(&category);
+
+        const Backpressure current = backpressure.load(std::memory_order_relaxed);
+        category.shedLevel.store(current == Backpressure::None ? 0 : category.sheddingPolicy[static_cast<size_t>(current) - 1], std::memory_order_relaxed);
+
+        if(!enabled.load(std::memory_order_relaxed))
+        {
+            monitor.windowBegin = std::chrono::system_clock::now();
+            enabled.store(true, std::memory_order_relaxed);
+        }
+    }
+    void LoadShedding::SetOptions(const Options& options)
+    {
+        std::lock_guard lock{ Logger::logMutex };
+        GetSheddingMonitor().options = options;
+    }
+    Backpressure LoadShedding::GetBackpressure()
+    {
+        return backpressure.load(std::memory_order_relaxed);
+    }
+
+    void LoadShedding::WriteSummary(const std::chrono::system_clock::time_point& time, const std::chrono::system_clock::duration& duration)
+    {
+        constexpr LogLevel level = LogLevel::Warning;
+        constexpr std::string_view name = "LoadShedding";
+
+        auto& monitor = GetSheddingMonitor();
+
+        std::string line;
+
+        Logger::AppendTime(line, time);
+        Logger::AppendPrefix<level, GE_LOG_LEVELS_COLORS_VARIABLE(Core)>(line, name, Logger::colorsEnabled);
+        Logger::FormatTo(line, "backpressure has cleared after ", std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), " ms, shed records:");
+
+        bool anyShed = false;
+
+        for(const auto& category : monitor.categories)
+        {
+            bool categoryShed = false;
+
+            for(size_t i = 0; i < levelsCount; ++i)
+            {
+                const uint64_t count = category->shedCounts[i].exchange(0, std::memory_order_relaxed);
+                if(count == 0)
+                    continue;
+
+                if(!categoryShed)
+                    Logger::FormatTo(line, anyShed ? "; " : " ", category->name);
+
+                const std::string_view tag = GetLogLevelTag(static_cast<LogLevel>(1 << i));
+                Logger::FormatTo(line, ' ', tag.substr(1, tag.size() - 2), '=', count);
+
+                categoryShed = anyShed = true;
+            }
+        }
+
+        if(!anyShed)
+            line.append(" none");
+
+        Logger::AppendColorReset(line);
+        line.push_back('\n');
+
+        //logMutex is already locked
+        Logger::Dispatch(LogRecord{ line, name, level, time, nullptr, Logger::colorsEnabled });
+    }
+
+    void LoadShedding::CountShed(CategoryState& category, const LogLevel& level)
+    {
+        const uint64_t previous = category.shedCounts[std::countr_zero(static_cast<uint8_t>(level))].fetch_add(1, std::memory_order_relaxed);
+
+        //a writer thread may already hold logMutex(GE_LOG inside a sink), try_lock by its owner is UB
+        if(previous % 64 != 0 || Logger::isWriterThread || !Logger::logMutex.try_lock())
+            return;
+
+        std::lock_guard lock{ Logger::logMutex, std::adopt_lock };
+        Evaluate(std::chrono::system_clock::now());
+    }
+
+    void LoadShedding::AddLockSample(const std::chrono::system_clock::time_point& time, const std::chrono::nanoseconds& lockWait)
+    {
+        auto& monitor = GetSheddingMonitor();
+
+        ++monitor.recordsCount;
+        monitor.lockWait += lockWait;
+
+        Evaluate(time);
+    }
+    void LoadShedding::AddQueueSample(const std::chrono::system_clock::time_point& time, const double& queueFill)
+    {
+        auto& monitor = GetSheddingMonitor();
+
+        monitor.maxQueueFill = std::max(monitor.maxQueueFill, queueFill);
+
+        Evaluate(time);
+    }
+
+    void LoadShedding::Evaluate(const std::chrono::system_clock::time_point& time)
+    {
+        auto& monitor = GetSheddingMonitor();
+        const auto& options = monitor.options;
+
+        if(time - monitor.windowBegin < options.window)
+            return;
+
+        const auto meanLockWait = monitor.recordsCount != 0 ? monitor.lockWait / static_cast<int64_t>(monitor.recordsCount) : std::chrono::nanoseconds{};
+
+        Backpressure measured = Backpressure::None;
+        if(meanLockWait >= options.highLockWait || monitor.maxQueueFill >= options.highQueueFill)
+            measured = Backpressure::High;
+        else if(meanLockWait >= options.elevatedLockWait || monitor.maxQueueFill >= options.elevatedQueueFill)
+            measured = Backpressure::Elevated;
+
+        monitor.windowBegin = time;
+        monitor.recordsCount = 0;
+        monitor.lockWait = {};
+        monitor.maxQueueFill = 0;
+
+        const Backpressure current = backpressure.load(std::memory_order_relaxed);
+
+        if(measured >= current)
+        {
+            monitor.lastPressured = time;
+
+            if(measured == current)
+                return;
+        }
+        //shedding lowers the pressure by itself, so it goes down only after a while
+        else if(time - monitor.lastPressured < options.coolDown)
+            return;
+        else
+            monitor.lastPressured = time;
+
+        if(current == Backpressure::None)
+            monitor.sheddingBegin = time;
+
+        backpressure.store(measured, std::memory_order_relaxed);
+
+        for(const auto& category : monitor.categories)
+            category->shedLevel.store(measured == Backpressure::None ? 0 : category->sheddingPolicy[static_cast<size_t>(measured) - 1], std::memory_order_relaxed);
+
+        if(measured == Backpressure::None)
+            WriteSummary(time, time - monitor.sheddingBegin);
+    }
+
+}
@@ -0,0 +1,516 @@
+#include "../include/GuelderConsoleLogBinary.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+//call sites
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        struct CallSiteRegistry final
+        {
+            std::mutex mutex;
+            //deque keeps addresses stable, id is index + 1
+            std::deque<BinaryCallSite> callSites;
+        };
+
+        //call sites are registered during static initialization of any translation unit
+        CallSiteRegistry& GetCallSiteRegistry()
+        {
+            static CallSiteRegistry registry;
+            return registry;
+        }
+    }
+
+    uint32_t BinaryLogger::RegisterCallSite(BinaryCallSite&& callSite)
+    {
+        auto& registry = GetCallSiteRegistry();
+        std::lock_guard lock{ registry.mutex };
+
+        registry.callSites.push_back(std::move(callSite));
+
+        return static_cast<uint32_t>(registry.callSites.size());
+    }
+    const BinaryCallSite* BinaryLogger::GetCallSite(const uint32_t& id)
+    {
+        auto& registry = GetCallSiteRegistry();
+        std::lock_guard lock{ registry.mutex };
+
+        if(id == 0 || id > registry.callSites.size())
+            return nullptr;
+
+        return &registry.callSites[id - 1];
+    }
+}
+
+//staging buffers
+namespace GuelderConsoleLog
+{
+    /**
+     * \brief Single-producer single-consumer ring of records: uint32_t size + bytes. A record never wraps around the end,
+     * the rest of the ring is skipped instead(marked with wrapMarker if there is enough place for it).
+     */
+    class BinaryLogger::StagingBuffer final
+    {
+    public:
+        explicit StagingBuffer(const size_t& capacity)
+            : capacity(capacity), data(std::make_unique<char[]>(capacity)) {}
+
+        /**
+         * \return false if there is no place right now.
+         */
+        bool TryWrite(const std::string_view& record)
+        {
+            const size_t position = head.load(std::memory_order_relaxed);
+            const size_t offset = position % capacity;
+            const size_t contiguous = capacity - offset;
+            const size_t needed = sizeof(uint32_t) + record.size();
+            const size_t skipped = needed > contiguous ? contiguous : 0;
+
+            if(capacity - (position - cachedTail) < skipped + needed)
+            {
+                cachedTail = tail.load(std::memory_order_acquire);
+
+                if(capacity - (position - cachedTail) < skipped + needed)
+                    return false;
+            }
+
+            char* destination = data.get() + offset;
+
+            if(skipped != 0)
+            {
+                if(contiguous >= sizeof(uint32_t))
+                    std::memcpy(destination, &wrapMarker, sizeof(uint32_t));
+
+                destination = data.get();
+            }
+
+            const uint32_t size = static_cast<uint32_t>(record.size());
+            std::memcpy(destination, &size, sizeof(uint32_t));
+            std::memcpy(destination + sizeof(uint32_t), record.data(), record.size());
+
+            head.store(position + skipped + needed, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * \brief Calls consumer for every record, which is in the buffer now.
+         * \return Count of records.
+         */
+        template<typename Consumer>
+        size_t Read(Consumer&& consumer)
+        {
+            size_t position = tail.load(std::memory_order_relaxed);
+            const size_t end = head.load(std::memory_order_acquire);
+
+            size_t count = 0;
+
+            while(position != end)
+            {
+                const size_t offset = position % capacity;
+                const size_t contiguous = capacity - offset;
+
+                uint32_t size = wrapMarker;
+                if(contiguous >= sizeof(uint32_t))
+                    std::memcpy(&size, data.get() + offset, sizeof(uint32_t));
+
+                if(size == wrapMarker)
+                {
+                    position += contiguous;
+                    continue;
+                }
+
+                consumer(std::string_view{ data.get() + offset + sizeof(uint32_t), size });
+
+                position += sizeof(uint32_t) + size;
+                ++count;
+            }
+
+            tail.store(position, std::memory_order_release);
+
+            return count;
+        }
+
+        [[nodiscard]]
+        size_t GetCapacity() const
+        {
+            return capacity;
+        }
+
+    public:
+        //set by the owning thread when it exits
+        std::atomic<bool> retired = false;
+
+    private:
+        static constexpr uint32_t wrapMarker = std::numeric_limits<uint32_t>::max();
+
+        const size_t capacity;
+        std::unique_ptr<char[]> data;
+
+        alignas(64) std::atomic<size_t> head = 0;
+        //producer's copy of tail, so it doesn't touch the consumer's cache line every time
+        size_t cachedTail = 0;
+        alignas(64) std::atomic<size_t> tail = 0;
+    };
+}
+
+//backend
+namespace GuelderConsoleLog
+{
+    struct BinaryLogger::Backend final
+    {
+        Options options;
+
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<StagingBuffer>> buffers;
+        //incremented by every Start, so threads know their staging buffers are from the previous session
+        std::atomic<uint64_t> session = 0;
+
+        std::thread worker;
+        std::FILE* file = nullptr;
+        std::string fileBuffer;
+        //call sites, which are already defined in the file
+        std::vector<bool> definedCallSites;
+        //call sites, whose records have the time, is filled along with definedCallSites
+        std::vector<bool> timedCallSites;
+
+        //UTC offset, which the decoder applies to the following records
+        int32_t writtenUTCOffset = 0;
+        //the offset is looked up once per period of 15 minutes of the records' time, DST changes happen at their boundaries
+        int64_t checkedUTCOffsetPeriod = std::numeric_limits<int64_t>::min();
+        int32_t checkedUTCOffset = 0;
+
+        //guards everything below
+        std::mutex flushMutex;
+        std::condition_variable flushChanged;
+        uint64_t requestedFlushes = 0;
+        uint64_t completedFlushes = 0;
+        bool stopRequested = false;
+
+        std::atomic<uint64_t> droppedCount = 0;
+
+        //serializes Start and Stop
+        std::mutex controlMutex;
+
+        //GetBackend mustn't be called here: the backend is a function-local static, which may be being destroyed
+        void Stop()
+        {
+            std::lock_guard controlLock{ controlMutex };
+
+            if(!running.load())
+                return;
+
+            running.store(false);
+
+            {
+                std::lock_guard lock{ flushMutex };
+                stopRequested = true;
+            }
+            flushChanged.notify_all();
+
+            worker.join();
+
+            std::fclose(file);
+            file = nullptr;
+        }
+
+        ~Backend()
+        {
+            Stop();
+        }
+    };
+
+    std::atomic<bool> BinaryLogger::running = false;
+
+    namespace
+    {
+        template<typename T>
+        void AppendBytes(std::string& out, const T& value)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        int64_t DaysFromCivil(int64_t year, const unsigned& month, const unsigned& day)
+        {
+            year -= month <= 2;
+            const int64_t era = (year >= 0 ? year : year - 399) / 400;
+            const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+            const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+            return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+        }
+        /**
+         * \return How many seconds local time is ahead of UTC at the time.
+         */
+        int32_t GetUTCOffset(const time_t& time)
+        {
+            tm localTime;
+#ifdef WIN32
+            localtime_s(&localTime, &time);
+#else
+            localtime_r(&time, &localTime);
+#endif
+            const int64_t localSeconds = DaysFromCivil(localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday) * 86400 +
+                localTime.tm_hour * 3600 + localTime.tm_min * 60 + localTime.tm_sec;
+
+            return static_cast<int32_t>(localSeconds - static_cast<int64_t>(time));
+        }
+    }
+
+    void BinaryLogger::Start(const std::filesystem::path& path, const Options& options)
+    {
+        auto& backend = GetBackend();
+        std::lock_guard controlLock{ backend.controlMutex };
+
+        if(running.load())
+            return;
+
+#ifdef WIN32
+        backend.file = _wfopen(path.c_str(), L"wb");
+#else
+        backend.file = std::fopen(path.c_str(), "wb");
+#endif
+        if(!backend.file)
+            Logger::Throw(Logger::Format("BinaryLogger::Start: failed to open \"", path.string(), '"'), __FILE__, __LINE__);
+
+        std::setvbuf(backend.file, nullptr, _IONBF, 0);
+
+        backend.options = options;
+        backend.fileBuffer.clear();
+        backend.fileBuffer.reserve(options.fileBufferSize);
+        backend.definedCallSites.clear();
+        backend.timedCallSites.clear();
+        backend.writtenUTCOffset = GetUTCOffset(std::time(nullptr));
+        backend.checkedUTCOffsetPeriod = std::numeric_limits<int64_t>::min();
+        backend.stopRequested = false;
+
+        std::string header{ BinaryFormat::magic, sizeof(BinaryFormat::magic) };
+        AppendBytes(header, BinaryFormat::version);
+        AppendBytes(header, static_cast<uint8_t>(Logger::GetTimestampPrecision()));
+        AppendBytes(header, static_cast<uint8_t>(Logger::GetTimestampZone()));
+        AppendBytes(header, backend.writtenUTCOffset);
+        std::fwrite(header.data(), 1, header.size(), backend.file);
+
+        {
+            std::lock_guard lock{ backend.buffersMutex };
+            backend.buffers.clear();
+            backend.session.fetch_add(1);
+        }
+
+        backend.worker = std::thread{ RunWorker };
+
+        running.store(true);
+    }
+    void BinaryLogger::Start(const std::filesystem::path& path)
+    {
+        Start(path, Options{});
+    }
+    void BinaryLogger::Stop()
+    {
+        GetBackend().Stop();
+    }
+    void BinaryLogger::Flush()
+    {
+        if(!running.load())
+            return;
+
+        auto& backend = GetBackend();
+        std::unique_lock lock{ backend.flushMutex };
+
+        const uint64_t target = ++backend.requestedFlushes;
+        backend.flushChanged.notify_all();
+        backend.flushChanged.wait(lock, [&] { return backend.completedFlushes >= target || backend.stopRequested; });
+    }
+    bool BinaryLogger::IsRunning()
+    {
+        return running.load(std::memory_order_relaxed);
+    }
+    uint64_t BinaryLogger::GetDroppedCount()
+    {
+        return GetBackend().droppedCount.load(std::memory_order_relaxed);
+    }
+
+    void BinaryLogger::Submit(const std::string_view& record)
+    {
+        struct ThreadStaging final
+        {
+            ~ThreadStaging()
+            {
+                if(buffer)
+                    buffer->retired.store(true, std::memory_order_release);
+            }
+
+            std::shared_ptr<StagingBuffer> buffer;
+            uint64_t session = 0;
+        };
+        thread_local ThreadStaging staging;
+
+        auto& backend = GetBackend();
+
+        if(staging.session != backend.session.load(std::memory_order_relaxed))
+        {
+            staging.buffer = std::make_shared<StagingBuffer>(backend.options.stagingBufferSize);
+            staging.session = backend.session.load();
+
+            std::lock_guard lock{ backend.buffersMutex };
+            backend.buffers.push_back(staging.buffer);
+        }
+
+        if(sizeof(uint32_t) + record.size() > staging.buffer->GetCapacity() / 2)
+        {
+            backend.droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        while(!staging.buffer->TryWrite(record))
+        {
+            if(!running.load(std::memory_order_relaxed))
+            {
+                backend.droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    BinaryLogger::Backend& BinaryLogger::GetBackend()
+    {
+        static Backend backend;
+        return backend;
+    }
+    void BinaryLogger::RunWorker()
+    {
+        auto& backend = GetBackend();
+
+        const auto writeFileBuffer = [&backend]
+            {
+                if(!backend.fileBuffer.empty())
+                    std::fwrite(backend.fileBuffer.data(), 1, backend.fileBuffer.size(), backend.file);
+                backend.fileBuffer.clear();
+            };
+        const auto writeRecord = [&backend, &writeFileBuffer](const std::string_view& record)
+            {
+                uint32_t id = 0;
+                std::memcpy(&id, record.data(), sizeof(uint32_t));
+
+                if(backend.definedCallSites.size() <= id)
+                {
+                    backend.definedCallSites.resize(id + 1, false);
+                    backend.timedCallSites.resize(id + 1, false);
+                }
+
+                if(!backend.definedCallSites[id])
+                {
+                    const BinaryCallSite* callSite = GetCallSite(id);
+
+                    std::string payload;
+                    AppendBytes(payload, id);
+                    AppendBytes(payload, static_cast<uint8_t>(callSite->level));
+                    AppendBytes(payload, static_cast<uint8_t>(callSite->writeTime));
+                    AppendBytes(payload, static_cast<uint16_t>(callSite->categoryName.size()));
+                    payload.append(callSite->categoryName);
+                    AppendBytes(payload, static_cast<uint16_t>(callSite->argTypes.size()));
+                    for(const auto& type : callSite->argTypes)
+                        AppendBytes(payload, static_cast<uint8_t>(type));
+
+                    AppendBytes(backend.fileBuffer, BinaryFormat::EntryKind::CallSite);
+                    AppendBytes(backend.fileBuffer, static_cast<uint32_t>(payload.size()));
+                    backend.fileBuffer.append(payload);
+
+                    backend.definedCallSites[id] = true;
+                    backend.timedCallSites[id] = callSite->writeTime;
+                }
+
+                //the local time of records after a DST change has another offset
+                if(backend.timedCallSites[id])
+                {
+                    int64_t nanoseconds;
+                    std::memcpy(&nanoseconds, record.data() + sizeof(uint32_t), sizeof(int64_t));
+
+                    const int64_t second = nanoseconds >= 0 ? nanoseconds / 1'000'000'000 : (nanoseconds + 1) / 1'000'000'000 - 1;
+                    const int64_t period = second >= 0 ? second / 900 : (second + 1) / 900 - 1;
+
+                    if(period != backend.checkedUTCOffsetPeriod)
+                    {
+                        backend.checkedUTCOffsetPeriod = period;
+                        backend.checkedUTCOffset = GetUTCOffset(static_cast<time_t>(period * 900));
+                    }
+
+                    if(backend.checkedUTCOffset != backend.writtenUTCOffset)
+                    {
+                        AppendBytes(backend.fileBuffer, BinaryFormat::EntryKind::UTCOffset);
+                        AppendBytes(backend.fileBuffer, static_cast<uint32_t>(sizeof(int32_t)));
+                        AppendBytes(backend.fileBuffer, backend.checkedUTCOffset);
+
+                        backend.writtenUTCOffset = backend.checkedUTCOffset;
+                    }
+                }
+
+                AppendBytes(backend.fileBuffer, BinaryFormat::EntryKind::Record);
+                AppendBytes(backend.fileBuffer, static_cast<uint32_t>(record.size()));
+                backend.fileBuffer.append(record);
+
+                if(backend.fileBuffer.size() >= backend.options.fileBufferSize)
+                    writeFileBuffer();
+            };
+
+        std::vector<std::shared_ptr<StagingBuffer>> buffers;
+
+        while(true)
+        {
+            uint64_t requestedFlushes;
+            bool stopRequested;
+            {
+                std::lock_guard lock{ backend.flushMutex };
+                requestedFlushes = backend.requestedFlushes;
+                stopRequested = backend.stopRequested;
+            }
+
+            {
+                std::lock_guard lock{ backend.buffersMutex };
+                buffers = backend.buffers;
+            }
+
+            size_t count = 0;
+            for(const auto& buffer : buffers)
+            {
+                //checked before reading, so nothing is lost if the thread writes its last record right now
+                const bool retired = buffer->retired.load(std::memory_order_acquire);
+
+                count += buffer->Read(writeRecord);
+
+                if(retired)
+                {
+                    std::lock_guard lock{ backend.buffersMutex };
+                    std::erase(backend.buffers, buffer);
+                }
+            }
+
+            if(count != 0 && !stopRequested)
+                continue;
+
+            writeFileBuffer();
+
+            std::unique_lock lock{ backend.flushMutex };
+
+            if(backend.completedFlushes != requestedFlushes)
+            {
+                backend.completedFlushes = requestedFlushes;
+                backend.flushChanged.notify_all();
+            }
+
+            if(stopRequested)
+                break;
+
+            backend.flushChanged.wait_for(lock, backend.options.pollInterval, [&] { return backend.requestedFlushes != requestedFlushes || backend.stopRequested; });
+        }
+    }
+}
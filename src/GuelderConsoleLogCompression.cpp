@@ -0,0 +1,205 @@
+#include "../include/GuelderConsoleLogCompression.hpp"
+
+#include <cstring>
+
+//LZ block codec
+namespace GuelderConsoleLog::Compression
+{
+    namespace
+    {
+        //16 KiB table, small enough for the stack and for L1
+        constexpr size_t hashBits = 12;
+
+        uint32_t Load32(const char* position)
+        {
+            uint32_t value;
+            std::memcpy(&value, position, sizeof(value));
+            return value;
+        }
+
+        uint32_t Hash(const uint32_t& sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - hashBits);
+        }
+
+        //writes the rest of a count, which didn't fit into the token's 4 bits
+        char* WriteLength(char* out, size_t length)
+        {
+            for(; length >= 255; length -= 255)
+                *out++ = static_cast<char>(255);
+
+            *out++ = static_cast<char>(length);
+
+            return out;
+        }
+        char* WriteSequence(char* out, const char* literals, const size_t& literalsCount, const size_t& offset, const size_t& matchLength)
+        {
+            char* token = out++;
+
+            const size_t matchCode = matchLength - minMatchLength;
+            *token = static_cast<char>((std::min<size_t>(literalsCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+
+            if(literalsCount >= 15)
+                out = WriteLength(out, literalsCount - 15);
+
+            std::memcpy(out, literals, literalsCount);
+            out += literalsCount;
+
+            out[0] = static_cast<char>(offset & 0xFF);
+            out[1] = static_cast<char>(offset >> 8);
+            out += 2;
+
+            if(matchCode >= 15)
+                out = WriteLength(out, matchCode - 15);
+
+            return out;
+        }
+
+        //reads the rest of a count after the token, false if the input ends before it
+        bool ReadLength(const unsigned char*& in, const unsigned char* end, size_t& length)
+        {
+            unsigned char byte;
+
+            do
+            {
+                if(in == end)
+                    return false;
+
+                byte = *in++;
+                length += byte;
+            } while(byte == 255);
+
+            return true;
+        }
+    }
+
+    size_t Compress(const char* in, const size_t& size, char* out)
+    {
+        Logger::Assert(size <= UINT32_MAX, "Compression::Compress: a block must be smaller than 4 GiB", __FILE__, __LINE__);
+
+        char* const outBegin = out;
+        const char* literals = in;
+
+        if(size > matchStartLimit)
+        {
+            uint32_t table[size_t{ 1 } << hashBits] = {};
+
+            const char* const matchLimit = in + size - matchStartLimit;
+            const char* const matchEnd = in + size - lastLiteralsCount;
+
+            const char* current = in + 1;
+            //the step grows while nothing is found, so incompressible data is skipped fast
+            size_t missesCount = 0;
+
+            while(current < matchLimit)
+            {
+                const uint32_t sequence = Load32(current);
+                const uint32_t hash = Hash(sequence);
+
+                const char* candidate = in + table[hash];
+                table[hash] = static_cast<uint32_t>(current - in);
+
+                if(candidate >= current || static_cast<size_t>(current - candidate) > maxOffset || Load32(candidate) != sequence)
+                {
+                    current += 1 + (missesCount++ >> 6);
+                    continue;
+                }
+
+                missesCount = 0;
+
+                //the match is extended backwards over the literals and forwards until the last literals
+                while(current > literals && candidate > in && current[-1] == candidate[-1])
+                {
+                    --current;
+                    --candidate;
+                }
+
+                size_t matchLength = minMatchLength;
+                while(current + matchLength < matchEnd && current[matchLength] == candidate[matchLength])
+                    ++matchLength;
+
+                out = WriteSequence(out, literals, static_cast<size_t>(current - literals), static_cast<size_t>(current - candidate), matchLength);
+
+                current += matchLength;
+                literals = current;
+
+                //the positions inside the match aren't hashed, the one before its end is enough for repetitive lines
+                if(current < matchLimit)
+                    table[Hash(Load32(current - 2))] = static_cast<uint32_t>(current - 2 - in);
+            }
+        }
+
+        //the last sequence
+        const size_t literalsCount = static_cast<size_t>(in + size - literals);
+
+        char* token = out++;
+        *token = static_cast<char>(std::min<size_t>(literalsCount, 15) << 4);
+
+        if(literalsCount >= 15)
+            out = WriteLength(out, literalsCount - 15);
+
+        std::memcpy(out, literals, literalsCount);
+        out += literalsCount;
+
+        return static_cast<size_t>(out - outBegin);
+    }
+
+    bool Decompress(const char* in, const size_t& inSize, char* out, const size_t& outSize)
+    {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(in);
+        const unsigned char* const inputEnd = input + inSize;
+
+        char* output = out;
+        char* const outputEnd = out + outSize;
+
+        while(input != inputEnd)
+        {
+            const unsigned char token = *input++;
+
+            size_t literalsCount = token >> 4;
+            if(literalsCount == 15 && !ReadLength(input, inputEnd, literalsCount))
+                return false;
+
+            if(static_cast<size_t>(inputEnd - input) < literalsCount || static_cast<size_t>(outputEnd - output) < literalsCount)
+                return false;
+
+            std::memcpy(output, input, literalsCount);
+            input += literalsCount;
+            output += literalsCount;
+
+            //the last sequence has no match
+            if(input == inputEnd)
+                break;
+
+            if(inputEnd - input < 2)
+                return false;
+
+            const size_t offset = input[0] | (static_cast<size_t>(input[1]) << 8);
+            input += 2;
+
+            size_t matchLength = token & 0x0F;
+            if(matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+                return false;
+            matchLength += minMatchLength;
+
+            if(offset == 0 || offset > static_cast<size_t>(output - out) || static_cast<size_t>(outputEnd - output) < matchLength)
+                return false;
+
+            const char* match = output - offset;
+
+            if(offset >= matchLength)
+            {
+                std::memcpy(output, match, matchLength);
+                output += matchLength;
+            }
+            else
+            {
+                //the match overlaps the bytes it makes(e.g. a run of one byte)
+                for(size_t i = 0; i < matchLength; ++i)
+                    *output++ = match[i];
+            }
+        }
+
+        return output == outputEnd;
+    }
+}
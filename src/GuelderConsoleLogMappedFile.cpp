@@ -0,0 +1,116 @@
+#include "../include/GuelderConsoleLogMappedFile.hpp"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//MappedFile
+namespace GuelderConsoleLog
+{
+    std::unique_ptr<MappedFile> MappedFile::Create(const std::filesystem::path& path, const size_t& size)
+    {
+        std::unique_ptr<MappedFile> mapped{ new MappedFile{} };
+
+#ifdef WIN32
+        mapped->file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if(mapped->file != INVALID_HANDLE_VALUE)
+            mapped->mapping = CreateFileMappingW(mapped->file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+        if(mapped->mapping)
+            mapped->data = static_cast<char*>(MapViewOfFile(mapped->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+        const int descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+        if(descriptor >= 0)
+        {
+            if(ftruncate(descriptor, static_cast<off_t>(size)) == 0)
+            {
+                void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+                if(data != MAP_FAILED)
+                    mapped->data = static_cast<char*>(data);
+            }
+
+            close(descriptor);
+        }
+#endif
+
+        if(!mapped->data)
+            Logger::Throw(Logger::Format("MappedFile::Create: failed to create \"", path.string(), '"'), __FILE__, __LINE__);
+
+        mapped->size = size;
+
+        return mapped;
+    }
+    std::unique_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+    {
+        return Open(path, true);
+    }
+    std::unique_ptr<MappedFile> MappedFile::OpenReadOnly(const std::filesystem::path& path)
+    {
+        return Open(path, false);
+    }
+    std::unique_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path, const bool& writable)
+    {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+
+        if(error || size == 0)
+            return nullptr;
+
+        std::unique_ptr<MappedFile> mapped{ new MappedFile{} };
+
+#ifdef WIN32
+        mapped->file = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if(mapped->file != INVALID_HANDLE_VALUE)
+            mapped->mapping = CreateFileMappingW(mapped->file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if(mapped->mapping)
+            mapped->data = static_cast<char*>(MapViewOfFile(mapped->mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, static_cast<size_t>(size)));
+#else
+        const int descriptor = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+
+        if(descriptor >= 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(size), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+            if(data != MAP_FAILED)
+                mapped->data = static_cast<char*>(data);
+
+            close(descriptor);
+        }
+#endif
+
+        if(!mapped->data)
+            return nullptr;
+
+        mapped->size = static_cast<size_t>(size);
+
+        return mapped;
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef WIN32
+        if(data)
+            UnmapViewOfFile(data);
+        if(mapping)
+            CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if(data)
+            munmap(data, size);
+#endif
+    }
+
+    char* MappedFile::GetData() const
+    {
+        return data;
+    }
+    size_t MappedFile::GetSize() const
+    {
+        return size;
+    }
+}
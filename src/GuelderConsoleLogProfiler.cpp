@@ -0,0 +1,296 @@
+#include "../include/GuelderConsoleLogProfiler.hpp"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+//scopes
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        struct ScopeInfo final
+        {
+            std::string name;
+            const void* category = nullptr;
+            void(*writeSummary)(const void* category, const std::string_view& summary) = nullptr;
+
+            //merged values of the previous report, the next one writes only the difference
+            std::vector<uint64_t> reportedBuckets = std::vector<uint64_t>(Profiler::bucketsCount);
+            uint64_t reportedSum = 0;
+        };
+
+        struct ScopeRegistry final
+        {
+            std::mutex mutex;
+            //deque keeps addresses stable, id is index + 1
+            std::deque<ScopeInfo> scopes;
+        };
+
+        //scopes are registered on their first use, it can happen during static initialization
+        ScopeRegistry& GetScopeRegistry()
+        {
+            static ScopeRegistry registry;
+            return registry;
+        }
+
+        //every histogram ever created, new ones are pushed to the front, they are never freed
+        constinit std::atomic<Profiler::Histogram*> allHistograms = nullptr;
+
+        struct TicksCalibration final
+        {
+            uint64_t ticks = Profiler::GetTicks();
+            std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+        };
+        const TicksCalibration calibration;
+
+        double GetNanosecondsPerTick()
+        {
+#ifdef GE_PROFILER_TSC
+            //the first report may come right after the start
+            const auto minDuration = std::chrono::milliseconds{ 10 };
+            const auto elapsed = std::chrono::steady_clock::now() - calibration.time;
+            if(elapsed < minDuration)
+                std::this_thread::sleep_for(minDuration - elapsed);
+
+            const uint64_t ticks = Profiler::GetTicks();
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - calibration.time).count();
+
+            return static_cast<double>(nanoseconds) / static_cast<double>(ticks - calibration.ticks);
+#else
+            return 1.0;
+#endif
+        }
+
+        uint64_t GetPercentile(const std::vector<uint64_t>& buckets, const uint64_t& count, const double& percentile)
+        {
+            const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(percentile * static_cast<double>(count) + 0.5), 1);
+
+            uint64_t seen = 0;
+            for(size_t i = 0; i < buckets.size(); ++i)
+            {
+                seen += buckets[i];
+                if(seen >= rank)
+                    return Profiler::GetBucketValue(i);
+            }
+
+            return 0;
+        }
+    }
+
+    uint32_t Profiler::RegisterScope(const std::string_view& name, const void* category, const SummaryWriter& writeSummary)
+    {
+        auto& registry = GetScopeRegistry();
+        std::lock_guard lock{ registry.mutex };
+
+        registry.scopes.push_back(ScopeInfo{ std::string{ name }, category, writeSummary });
+
+        return static_cast<uint32_t>(registry.scopes.size());
+    }
+
+    Profiler::ThreadHistograms::~ThreadHistograms()
+    {
+        for(const auto& histogram : histograms)
+            if(histogram)
+                histogram->owned.store(false, std::memory_order_release);
+    }
+
+    Profiler::Histogram* Profiler::AcquireHistogram(const uint32_t& scopeId)
+    {
+        Histogram* histogram = nullptr;
+
+        for(Histogram* current = allHistograms.load(std::memory_order_acquire); current; current = current->next)
+        {
+            bool owned = false;
+            if(current->scopeId == scopeId && current->owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+            {
+                histogram = current;
+                break;
+            }
+        }
+
+        if(!histogram)
+        {
+            histogram = new Histogram{};
+            histogram->scopeId = scopeId;
+
+            histogram->next = allHistograms.load(std::memory_order_relaxed);
+            while(!allHistograms.compare_exchange_weak(histogram->next, histogram, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        auto& threadList = threadHistograms.histograms;
+        if(threadList.size() <= scopeId)
+            threadList.resize(scopeId + 1);
+
+        threadList[scopeId] = histogram;
+
+        return histogram;
+    }
+}
+
+//reports
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        struct Reporter final
+        {
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable wake;
+            bool stopRequested = false;
+
+            ~Reporter()
+            {
+                if(thread.joinable())
+                {
+                    {
+                        std::lock_guard lock{ mutex };
+                        stopRequested = true;
+                    }
+                    wake.notify_all();
+                    thread.join();
+                }
+            }
+        };
+
+        Reporter& GetReporter()
+        {
+            static Reporter reporter;
+            return reporter;
+        }
+
+        //serializes Start and Stop
+        std::mutex controlMutex;
+    }
+
+    void Profiler::Start(const std::chrono::milliseconds& interval)
+    {
+        std::lock_guard controlLock{ controlMutex };
+
+        auto& reporter = GetReporter();
+
+        if(reporter.thread.joinable())
+            return;
+
+        reporter.stopRequested = false;
+        reporter.thread = std::thread{ [&reporter, interval]
+            {
+                std::unique_lock lock{ reporter.mutex };
+
+                while(!reporter.wake.wait_for(lock, interval, [&reporter] { return reporter.stopRequested; }))
+                {
+                    lock.unlock();
+                    Report();
+                    lock.lock();
+                }
+            } };
+    }
+    void Profiler::Stop()
+    {
+        std::lock_guard controlLock{ controlMutex };
+
+        auto& reporter = GetReporter();
+
+        if(!reporter.thread.joinable())
+            return;
+
+        {
+            std::lock_guard lock{ reporter.mutex };
+            reporter.stopRequested = true;
+        }
+        reporter.wake.notify_all();
+        reporter.thread.join();
+
+        Report();
+    }
+
+    void Profiler::Report()
+    {
+        struct Pending final
+        {
+            std::string name;
+            const void* category;
+            SummaryWriter writeSummary;
+            std::vector<uint64_t> buckets;
+            uint64_t count;
+            uint64_t sum;
+            uint64_t max;
+        };
+        std::vector<Pending> pending;
+
+        //writeSummary goes through Logger and the sinks, which may register scopes, so the registry is unlocked before
+        {
+            auto& registry = GetScopeRegistry();
+            std::lock_guard lock{ registry.mutex };
+
+            if(registry.scopes.empty())
+                return;
+
+            struct Merged final
+            {
+                std::vector<uint64_t> buckets = std::vector<uint64_t>(bucketsCount);
+                uint64_t sum = 0;
+                uint64_t max = 0;
+            };
+            std::vector<Merged> merged(registry.scopes.size());
+
+            for(Histogram* histogram = allHistograms.load(std::memory_order_acquire); histogram; histogram = histogram->next)
+            {
+                auto& scope = merged[histogram->scopeId - 1];
+
+                for(size_t i = 0; i < bucketsCount; ++i)
+                    scope.buckets[i] += histogram->buckets[i].load(std::memory_order_relaxed);
+
+                scope.sum += histogram->sum.load(std::memory_order_relaxed);
+                scope.max = std::max(scope.max, histogram->max.exchange(0, std::memory_order_relaxed));
+            }
+
+            for(size_t id = 0; id < merged.size(); ++id)
+            {
+                auto& scope = registry.scopes[id];
+                auto& current = merged[id];
+
+                //counters of the owning threads may be a bit behind each other, so the count is taken from the buckets
+                for(size_t i = 0; i < bucketsCount; ++i)
+                {
+                    const uint64_t total = current.buckets[i];
+                    current.buckets[i] = total - std::min(total, scope.reportedBuckets[i]);
+                    scope.reportedBuckets[i] = std::max(total, scope.reportedBuckets[i]);
+                }
+
+                uint64_t count = 0;
+                for(const auto& bucket : current.buckets)
+                    count += bucket;
+
+                const uint64_t sum = current.sum - std::min(current.sum, scope.reportedSum);
+                scope.reportedSum = std::max(current.sum, scope.reportedSum);
+
+                if(count != 0)
+                    pending.push_back(Pending{ scope.name, scope.category, scope.writeSummary, std::move(current.buckets), count, sum, current.max });
+            }
+        }
+
+        if(pending.empty())
+            return;
+
+        //may sleep to calibrate the clock
+        const double nanosecondsPerTick = GetNanosecondsPerTick();
+        const auto toNanoseconds = [&nanosecondsPerTick](const double& ticks) { return static_cast<uint64_t>(ticks * nanosecondsPerTick + 0.5); };
+
+        std::string summary;
+
+        for(const auto& scope : pending)
+        {
+            summary.clear();
+            Logger::FormatTo(summary, "profile \"", scope.name, "\": count=", scope.count,
+                " mean_ns=", toNanoseconds(static_cast<double>(scope.sum) / static_cast<double>(scope.count)),
+                " p50_ns=", toNanoseconds(static_cast<double>(GetPercentile(scope.buckets, scope.count, 0.5))),
+                " p99_ns=", toNanoseconds(static_cast<double>(GetPercentile(scope.buckets, scope.count, 0.99))),
+                " max_ns=", toNanoseconds(static_cast<double>(scope.max)));
+
+            scope.writeSummary(scope.category, summary);
+        }
+    }
+}
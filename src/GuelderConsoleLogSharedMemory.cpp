@@ -0,0 +1,119 @@
+#include "../include/GuelderConsoleLogSharedMemory.hpp"
+
+#include <cstring>
+#include <bit>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+//SharedMemorySink
+namespace GuelderConsoleLog
+{
+    SharedMemorySink::SharedMemorySink(const Options& options)
+    {
+        using namespace SharedMemoryFormat;
+
+        Logger::Assert(!options.channel.empty() && options.channel.find_first_of("./\\") == std::string::npos, "SharedMemorySink::SharedMemorySink: the channel must be a non-empty name without '.', '/' and '\\'", __FILE__, __LINE__);
+
+        capacity = std::bit_ceil(std::max<uint64_t>(options.capacity, 4096));
+
+#ifdef WIN32
+        const auto processId = static_cast<int64_t>(GetCurrentProcessId());
+#else
+        const auto processId = static_cast<int64_t>(getpid());
+#endif
+        //a new process with the same id mustn't take the ring of the old one
+        const auto startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        path = options.directory / Logger::Format(options.channel, '.', processId, '.', startTime, fileExtension);
+        file = MappedFile::Create(path, sizeof(RingHeader) + capacity);
+
+        //the file is filled with zeros, so all the atomics are 0 already
+        header = reinterpret_cast<RingHeader*>(file->GetData());
+        data = file->GetData() + sizeof(RingHeader);
+
+        header->version = version;
+        header->headerSize = sizeof(RingHeader);
+        header->capacity = capacity;
+        header->processId = processId;
+
+        //the collector accepts the file only after the magic is written
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->magic, magic, sizeof(magic));
+    }
+    SharedMemorySink::SharedMemorySink()
+        : SharedMemorySink(Options{}) {}
+    SharedMemorySink::~SharedMemorySink()
+    {
+        header->closed.store(1, std::memory_order_release);
+    }
+
+    void SharedMemorySink::Write(const LogRecord& record)
+    {
+        using namespace SharedMemoryFormat;
+
+        std::string_view line = record.line;
+
+        if(record.colored)
+        {
+            uncolored.clear();
+            AppendWithoutColors(uncolored, line);
+            line = uncolored;
+        }
+
+        const uint64_t needed = GetRecordSize(line.size());
+
+        const uint64_t head = header->head.load(std::memory_order_relaxed);
+        const uint64_t offset = head & (capacity - 1);
+        const uint64_t contiguous = capacity - offset;
+        //a record never wraps around the end
+        const uint64_t skipped = needed > contiguous ? contiguous : 0;
+
+        if(needed > capacity / 2 || capacity - (head - cachedTail) < skipped + needed)
+        {
+            cachedTail = header->tail.load(std::memory_order_acquire);
+
+            if(needed > capacity / 2 || capacity - (head - cachedTail) < skipped + needed)
+            {
+                header->droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        char* destination = data + (skipped != 0 ? 0 : offset);
+
+        if(skipped != 0)
+            std::memcpy(data + offset, &wrapMarker, sizeof(wrapMarker));
+
+        const uint32_t size = static_cast<uint32_t>(line.size());
+        const auto level = static_cast<uint8_t>(record.level);
+        const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(record.time.time_since_epoch()).count();
+
+        std::memcpy(destination, &size, sizeof(size));
+        std::memcpy(destination + sizeof(size), &level, sizeof(level));
+        std::memcpy(destination + 8, &time, sizeof(time));
+        std::memcpy(destination + recordHeaderSize, line.data(), line.size());
+
+        header->head.store(head + skipped + needed, std::memory_order_release);
+    }
+
+    uint64_t SharedMemorySink::GetDroppedCount() const
+    {
+        return header->droppedCount.load(std::memory_order_relaxed);
+    }
+    const std::filesystem::path& SharedMemorySink::GetPath() const
+    {
+        return path;
+    }
+
+    std::filesystem::path SharedMemorySink::GetDefaultDirectory()
+    {
+        std::error_code error;
+
+        if(std::filesystem::is_directory("/dev/shm", error))
+            return "/dev/shm";
+
+        return std::filesystem::temp_directory_path(error);
+    }
+}
@@ -0,0 +1,486 @@
+#include "../include/GuelderConsoleLogSinks.hpp"
+#include "../include/GuelderConsoleLogCompression.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+
+//ConsoleSink
+namespace GuelderConsoleLog
+{
+    void AppendWithoutColors(std::string& out, const std::string_view& line)
+    {
+        size_t begin = 0;
+
+        while(begin < line.size())
+        {
+            const size_t escape = line.find('\x1b', begin);
+
+            if(escape == std::string_view::npos)
+                break;
+
+            out.append(line.substr(begin, escape - begin));
+
+            //skips up to the final byte of the sequence
+            size_t end = escape + 1;
+            if(end < line.size() && line[end] == '[')
+                while(++end < line.size() && !(line[end] >= 0x40 && line[end] <= 0x7E)) {}
+
+            begin = end + 1;
+        }
+
+        if(begin < line.size())
+            out.append(line.substr(begin));
+    }
+
+    namespace
+    {
+        /**
+         * \brief Writes all the parts to the standard output, on POSIX with as few writev calls as possible.
+         */
+        template<size_t count>
+        void WriteToConsole(std::string_view(&parts)[count])
+        {
+#ifdef WIN32
+            const HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+
+            for(const auto& part : parts)
+            {
+                DWORD written = 0;
+                if(!part.empty())
+                    WriteFile(console, part.data(), static_cast<DWORD>(part.size()), &written, nullptr);
+            }
+#else
+            size_t first = 0;
+
+            while(first != count)
+            {
+                if(parts[first].empty())
+                {
+                    ++first;
+                    continue;
+                }
+
+                iovec vectors[count];
+                for(size_t i = first; i < count; ++i)
+                    vectors[i - first] = iovec{ const_cast<char*>(parts[i].data()), parts[i].size() };
+
+                ssize_t written = writev(STDOUT_FILENO, vectors, static_cast<int>(count - first));
+
+                if(written < 0)
+                {
+                    if(errno == EINTR)
+                        continue;
+                    return;
+                }
+
+                //skips what was written, a part may be written partially
+                for(; first != count && static_cast<size_t>(written) >= parts[first].size(); ++first)
+                    written -= static_cast<ssize_t>(parts[first].size());
+
+                if(first != count)
+                    parts[first].remove_prefix(static_cast<size_t>(written));
+            }
+#endif
+        }
+    }
+
+    ConsoleSink::ConsoleSink(const Options& options)
+        : options(options)
+    {
+        Logger::Assert(options.maxBatchRecords != 0, "ConsoleSink::ConsoleSink: maxBatchRecords must be at least 1", __FILE__, __LINE__);
+
+        if(options.maxBatchRecords > 1)
+        {
+            batch.reserve(options.maxBatchBytes);
+
+            if(options.maxBatchDelay.count() != 0)
+                flusher = std::thread{ &ConsoleSink::RunFlusher, this };
+        }
+    }
+    ConsoleSink::~ConsoleSink()
+    {
+        {
+            std::lock_guard lock{ batchMutex };
+            stopRequested = true;
+        }
+        batchStarted.notify_all();
+
+        if(flusher.joinable())
+            flusher.join();
+
+        Flush();
+    }
+
+    void ConsoleSink::Write(const LogRecord& record)
+    {
+        if(options.maxBatchRecords == 1)
+        {
+            std::string_view parts[] = { record.line };
+            WriteToConsole(parts);
+            return;
+        }
+
+        std::lock_guard lock{ batchMutex };
+
+        //the line isn't copied, if it is written right now
+        if(record.level >= options.flushLevel || batch.size() + record.line.size() > options.maxBatchBytes)
+        {
+            WriteBatch(record.line);
+            return;
+        }
+
+        if(batchRecords == 0)
+        {
+            batchTime = std::chrono::steady_clock::now();
+            batchStarted.notify_all();
+        }
+
+        batch.append(record.line);
+        ++batchRecords;
+
+        if(batchRecords >= options.maxBatchRecords)
+            WriteBatch();
+    }
+    void ConsoleSink::Flush()
+    {
+        std::lock_guard lock{ batchMutex };
+
+        if(batchRecords != 0)
+            WriteBatch();
+    }
+
+    void ConsoleSink::WriteBatch(const std::string_view& line)
+    {
+        std::string_view parts[] = { batch, line };
+        WriteToConsole(parts);
+
+        batch.clear();
+        batchRecords = 0;
+    }
+    void ConsoleSink::RunFlusher()
+    {
+        const Logger::WriterScope writerScope;
+
+        std::unique_lock lock{ batchMutex };
+
+        while(!stopRequested)
+        {
+            if(batchRecords == 0)
+            {
+                batchStarted.wait(lock, [&] { return batchRecords != 0 || stopRequested; });
+                continue;
+            }
+
+            const auto deadline = batchTime + options.maxBatchDelay;
+
+            if(std::chrono::steady_clock::now() >= deadline)
+                WriteBatch();
+            else
+                batchStarted.wait_until(lock, deadline, [&] { return stopRequested; });
+        }
+    }
+}
+
+//FileSink
+namespace GuelderConsoleLog
+{
+    FileSink::FileSink(const Options& options)
+        : options(options)
+    {
+        Logger::Assert(options.buffersCount >= 2 && options.bufferSize != 0, "FileSink::FileSink: at least 2 non-empty buffers are needed", __FILE__, __LINE__);
+        Logger::Assert(!options.compress || options.bufferSize <= UINT32_MAX, "FileSink::FileSink: a compressed frame must be smaller than 4 GiB", __FILE__, __LINE__);
+
+        for(size_t i = 0; i < options.buffersCount; ++i)
+        {
+            Buffer buffer;
+            buffer.data.reset(static_cast<char*>(::operator new[](options.bufferSize, std::align_val_t{ bufferAlignment })));
+
+            freeBuffers.push_back(std::move(buffer));
+        }
+
+        active = std::move(freeBuffers.front());
+        freeBuffers.pop_front();
+
+        OpenFile();
+
+        if(!file)
+            Logger::Throw(Logger::Format("FileSink::FileSink: failed to open \"", options.path.string(), '"'), __FILE__, __LINE__);
+
+        std::error_code error;
+        const auto size = std::filesystem::file_size(options.path, error);
+        fileSize = error ? 0 : size;
+
+        nextRotationTime = GetNextRotationTime(std::chrono::system_clock::now());
+
+        writer = std::thread{ &FileSink::RunWriter, this };
+    }
+    FileSink::FileSink(const std::filesystem::path& path)
+        : FileSink(Options{ path }) {}
+    FileSink::~FileSink()
+    {
+        Flush();
+
+        {
+            std::lock_guard lock{ queueMutex };
+            stopRequested = true;
+        }
+        queueChanged.notify_all();
+
+        writer.join();
+
+        if(file)
+            std::fclose(file);
+    }
+
+    void FileSink::Write(const LogRecord& record)
+    {
+        WriteToBuffer(record);
+
+        if(record.level >= options.flushLevel)
+            Flush();
+    }
+    void FileSink::WriteToBuffer(const LogRecord& record)
+    {
+        std::lock_guard lock{ bufferMutex };
+
+        std::string_view line = record.line;
+
+        if(record.colored)
+        {
+            uncolored.clear();
+            AppendWithoutColors(uncolored, line);
+            line = uncolored;
+        }
+
+        const bool rotateBySize = options.maxFileSize != 0 && fileSize != 0 && fileSize + line.size() > options.maxFileSize;
+        const bool rotateByTime = options.rotationInterval.count() != 0 && record.time >= nextRotationTime;
+
+        if(rotateBySize || rotateByTime)
+        {
+            active.rotateAfter = true;
+            SubmitActiveBuffer();
+
+            fileSize = 0;
+            nextRotationTime = GetNextRotationTime(record.time);
+        }
+
+        //a frame has only whole lines, unless a line is longer than a buffer
+        if(options.compress && active.size != 0 && line.size() > options.bufferSize - active.size)
+            SubmitActiveBuffer();
+
+        Append(line);
+        fileSize += line.size();
+
+        ++active.recordsCount;
+        active.minTime = std::min(active.minTime, record.time);
+        active.maxTime = std::max(active.maxTime, record.time);
+    }
+    void FileSink::Flush()
+    {
+        uint64_t target;
+        {
+            std::lock_guard lock{ bufferMutex };
+
+            if(active.size != 0)
+                SubmitActiveBuffer();
+
+            std::lock_guard queueLock{ queueMutex };
+            target = submittedCount;
+        }
+
+        std::unique_lock lock{ queueMutex };
+        queueChanged.wait(lock, [&] { return writtenCount >= target; });
+    }
+
+    void FileSink::Append(const std::string_view& bytes)
+    {
+        size_t offset = 0;
+
+        while(offset != bytes.size())
+        {
+            if(active.size == options.bufferSize)
+                SubmitActiveBuffer();
+
+            const size_t count = std::min(options.bufferSize - active.size, bytes.size() - offset);
+
+            std::memcpy(active.data.get() + active.size, bytes.data() + offset, count);
+            active.size += count;
+            offset += count;
+        }
+    }
+    void FileSink::SubmitActiveBuffer()
+    {
+        std::unique_lock lock{ queueMutex };
+
+        pendingBuffers.push_back(std::move(active));
+        ++submittedCount;
+        queueChanged.notify_all();
+
+        queueChanged.wait(lock, [&] { return !freeBuffers.empty(); });
+
+        active = std::move(freeBuffers.front());
+        freeBuffers.pop_front();
+    }
+    void FileSink::RunWriter()
+    {
+        const Logger::WriterScope writerScope;
+
+        std::unique_lock lock{ queueMutex };
+
+        while(true)
+        {
+            if(pendingBuffers.empty())
+            {
+                if(stopRequested)
+                    break;
+
+                if(!queueChanged.wait_for(lock, options.flushInterval, [&] { return !pendingBuffers.empty() || stopRequested; }))
+                {
+                    //a partially filled buffer mustn't wait for more lines forever.
+                    //The writer mustn't wait for bufferMutex: its owner can be waiting in SubmitActiveBuffer for a buffer, which only the writer frees.
+                    //If the buffer is being filled right now, it is handed over on the next timeout or when it is full
+                    lock.unlock();
+                    if(std::unique_lock bufferLock{ bufferMutex, std::try_to_lock }; bufferLock.owns_lock())
+                    {
+                        std::lock_guard queueLock{ queueMutex };
+
+                        if(active.size != 0 && !freeBuffers.empty())
+                        {
+                            pendingBuffers.push_back(std::move(active));
+                            ++submittedCount;
+
+                            active = std::move(freeBuffers.front());
+                            freeBuffers.pop_front();
+                        }
+                    }
+                    lock.lock();
+                }
+
+                continue;
+            }
+
+            Buffer buffer = std::move(pendingBuffers.front());
+            pendingBuffers.pop_front();
+
+            lock.unlock();
+
+            if(file && buffer.size != 0)
+            {
+                if(options.compress)
+                    WriteFrame(buffer);
+                else
+                    std::fwrite(buffer.data.get(), 1, buffer.size, file);
+            }
+            if(buffer.rotateAfter)
+                RotateFile();
+
+            buffer.size = 0;
+            buffer.rotateAfter = false;
+            buffer.recordsCount = 0;
+            buffer.minTime = std::chrono::system_clock::time_point::max();
+            buffer.maxTime = std::chrono::system_clock::time_point::min();
+
+            lock.lock();
+
+            freeBuffers.push_back(std::move(buffer));
+            ++writtenCount;
+            queueChanged.notify_all();
+        }
+    }
+
+    void FileSink::WriteFrame(const Buffer& buffer)
+    {
+        using namespace CompressedFormat;
+
+        compressed.resize(sizeof(FrameHeader) + Compression::GetMaxCompressedSize(buffer.size));
+
+        size_t compressedSize = Compression::Compress(buffer.data.get(), buffer.size, compressed.data() + sizeof(FrameHeader));
+
+        FrameHeader header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+
+        if(compressedSize >= buffer.size)
+        {
+            std::memcpy(compressed.data() + sizeof(FrameHeader), buffer.data.get(), buffer.size);
+            compressedSize = buffer.size;
+            header.flags |= storedFlag;
+        }
+
+        //a frame can hold only the beginning of a line longer than a buffer
+        const bool hasRecords = buffer.recordsCount != 0;
+        const auto toNanoseconds = [](const std::chrono::system_clock::time_point& time) { return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(); };
+
+        header.compressedSize = static_cast<uint32_t>(compressedSize);
+        header.uncompressedSize = static_cast<uint32_t>(buffer.size);
+        header.recordsCount = buffer.recordsCount;
+        header.minTime = hasRecords ? toNanoseconds(buffer.minTime) : 0;
+        header.maxTime = hasRecords ? toNanoseconds(buffer.maxTime) : 0;
+        header.headerChecksum = GetHeaderChecksum(header);
+
+        std::memcpy(compressed.data(), &header, sizeof(header));
+
+        //the header and the data go with one write, so a reader never sees a header without its data, unless the process dies in the middle
+        std::fwrite(compressed.data(), 1, sizeof(FrameHeader) + compressedSize, file);
+    }
+
+    void FileSink::OpenFile()
+    {
+#ifdef WIN32
+        file = _wfopen(options.path.c_str(), L"ab");
+#else
+        file = std::fopen(options.path.c_str(), "ab");
+#endif
+
+        //buffers are already big, every fwrite should go straight to the system
+        if(file)
+            std::setvbuf(file, nullptr, _IONBF, 0);
+    }
+    void FileSink::RotateFile()
+    {
+        if(file)
+        {
+            std::fclose(file);
+            file = nullptr;
+        }
+
+        std::error_code error;
+        const auto backupPath = [&](const size_t& index)
+            {
+                auto path = options.path;
+                path += '.' + std::to_string(index);
+                return path;
+            };
+
+        if(options.maxBackupCount == 0)
+            std::filesystem::remove(options.path, error);
+        else
+        {
+            std::filesystem::remove(backupPath(options.maxBackupCount), error);
+
+            for(size_t i = options.maxBackupCount - 1; i > 0; --i)
+                std::filesystem::rename(backupPath(i), backupPath(i + 1), error);
+
+            std::filesystem::rename(options.path, backupPath(1), error);
+        }
+
+        OpenFile();
+    }
+
+    std::chrono::system_clock::time_point FileSink::GetNextRotationTime(const std::chrono::system_clock::time_point& time) const
+    {
+        if(options.rotationInterval.count() == 0)
+            return std::chrono::system_clock::time_point::max();
+
+        const auto interval = std::chrono::duration_cast<std::chrono::system_clock::duration>(options.rotationInterval);
+
+        return std::chrono::system_clock::time_point{ (time.time_since_epoch() / interval + 1) * interval };
+    }
+}
@@ -0,0 +1,277 @@
+#include "../include/GuelderConsoleLogSharedMemory.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <csignal>
+#include <queue>
+#include <thread>
+
+#ifndef WIN32
+#include <signal.h>
+#include <cerrno>
+#endif
+
+//reads the rings written by GuelderConsoleLog::SharedMemorySink of all the processes of a channel and writes their lines merged by time
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        //a record is written only when it is older than this, so records of other rings, which were logged earlier, can still come
+        constexpr std::chrono::milliseconds reorderWindow{ 100 };
+        constexpr std::chrono::milliseconds scanInterval{ 200 };
+        constexpr std::chrono::milliseconds idleSleep{ 5 };
+
+        std::atomic<bool> stopRequested = false;
+
+        void OnStopSignal(int)
+        {
+            stopRequested.store(true);
+        }
+
+        bool IsProcessAlive(const int64_t& processId)
+        {
+#ifdef WIN32
+            const HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(processId));
+            if(!process)
+                return false;
+
+            const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+            CloseHandle(process);
+
+            return alive;
+#else
+            return kill(static_cast<pid_t>(processId), 0) == 0 || errno != ESRCH;
+#endif
+        }
+
+        struct Ring final
+        {
+            std::filesystem::path path;
+            std::unique_ptr<MappedFile> file;
+
+            SharedMemoryFormat::RingHeader* header = nullptr;
+            const char* data = nullptr;
+            uint64_t capacity = 0;
+
+            uint64_t reportedDroppedCount = 0;
+        };
+
+        /**
+         * \return nullptr if the file isn't a complete ring(yet).
+         */
+        std::unique_ptr<Ring> OpenRing(const std::filesystem::path& path)
+        {
+            using namespace SharedMemoryFormat;
+
+            auto file = MappedFile::Open(path);
+
+            if(!file || file->GetSize() < sizeof(RingHeader))
+                return nullptr;
+
+            auto* header = reinterpret_cast<RingHeader*>(file->GetData());
+
+            if(std::memcmp(header->magic, magic, sizeof(magic)) != 0)
+                return nullptr;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if(header->version != version || header->headerSize != sizeof(RingHeader) || !std::has_single_bit(header->capacity) || file->GetSize() != sizeof(RingHeader) + header->capacity)
+                return nullptr;
+
+            auto ring = std::make_unique<Ring>();
+            ring->path = path;
+            ring->header = header;
+            ring->data = file->GetData() + sizeof(RingHeader);
+            ring->capacity = header->capacity;
+            ring->file = std::move(file);
+
+            return ring;
+        }
+
+        struct PendingRecord final
+        {
+            int64_t time = 0;
+            //keeps the order of records with the same time
+            uint64_t sequence = 0;
+            std::string line;
+
+            bool operator>(const PendingRecord& other) const
+            {
+                return time != other.time ? time > other.time : sequence > other.sequence;
+            }
+        };
+
+        using PendingRecords = std::priority_queue<PendingRecord, std::vector<PendingRecord>, std::greater<>>;
+
+        /**
+         * \brief Moves every record, which is in the ring now, into pending.
+         * \return false if the ring is corrupted, the producer's memory is never trusted.
+         */
+        bool DrainRing(Ring& ring, PendingRecords& pending, uint64_t& sequence)
+        {
+            using namespace SharedMemoryFormat;
+
+            const uint64_t head = ring.header->head.load(std::memory_order_acquire);
+            uint64_t tail = ring.header->tail.load(std::memory_order_relaxed);
+
+            if(head < tail || head - tail > ring.capacity)
+                return false;
+
+            while(tail != head)
+            {
+                const uint64_t offset = tail & (ring.capacity - 1);
+                const uint64_t contiguous = ring.capacity - offset;
+                const uint64_t available = head - tail;
+
+                uint32_t size;
+                std::memcpy(&size, ring.data + offset, sizeof(size));
+
+                if(size == wrapMarker)
+                {
+                    if(contiguous > available)
+                        return false;
+
+                    tail += contiguous;
+                    continue;
+                }
+
+                const uint64_t recordSize = GetRecordSize(size);
+
+                if(recordSize > contiguous || recordSize > available)
+                    return false;
+
+                PendingRecord record;
+                std::memcpy(&record.time, ring.data + offset + 8, sizeof(record.time));
+                record.line.assign(ring.data + offset + recordHeaderSize, size);
+                record.sequence = sequence++;
+
+                pending.push(std::move(record));
+
+                tail += recordSize;
+            }
+
+            ring.header->tail.store(tail, std::memory_order_release);
+
+            return true;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace GuelderConsoleLog;
+
+    if(argc < 2 || argc > 4)
+    {
+        std::fprintf(stderr, "usage: GuelderConsoleLogCollector <channel> [output file] [directory of the rings]\n");
+        return 1;
+    }
+
+    const std::string channel = argv[1];
+    const std::filesystem::path directory = argc == 4 ? std::filesystem::path{ argv[3] } : SharedMemorySink::GetDefaultDirectory();
+
+    std::FILE* output = argc >= 3 ? std::fopen(argv[2], "ab") : stdout;
+    if(!output)
+    {
+        std::fprintf(stderr, "failed to open \"%s\"\n", argv[2]);
+        return 1;
+    }
+
+    std::signal(SIGINT, OnStopSignal);
+    std::signal(SIGTERM, OnStopSignal);
+
+    const std::string prefix = channel + '.';
+
+    std::vector<std::unique_ptr<Ring>> rings;
+    PendingRecords pending;
+    uint64_t sequence = 0;
+
+    auto lastScan = std::chrono::steady_clock::time_point{};
+
+    while(true)
+    {
+        const bool stopping = stopRequested.load();
+        const auto now = std::chrono::steady_clock::now();
+
+        if(now - lastScan >= scanInterval)
+        {
+            lastScan = now;
+
+            std::error_code error;
+            for(const auto& entry : std::filesystem::directory_iterator{ directory, error })
+            {
+                const auto path = entry.path();
+                const auto name = path.filename().string();
+
+                if(!name.starts_with(prefix) || path.extension() != SharedMemoryFormat::fileExtension)
+                    continue;
+                if(std::any_of(rings.begin(), rings.end(), [&path](const auto& ring) { return ring->path == path; }))
+                    continue;
+
+                if(auto ring = OpenRing(path))
+                    rings.push_back(std::move(ring));
+            }
+        }
+
+        const size_t pendingBefore = pending.size();
+
+        for(auto it = rings.begin(); it != rings.end();)
+        {
+            Ring& ring = **it;
+
+            //checked before draining, so nothing written before the end is lost
+            const bool finished = ring.header->closed.load(std::memory_order_acquire) != 0 || !IsProcessAlive(ring.header->processId);
+
+            if(!DrainRing(ring, pending, sequence))
+            {
+                std::fprintf(stderr, "\"%s\" is corrupted, it is skipped\n", ring.path.string().c_str());
+                it = rings.erase(it);
+                continue;
+            }
+
+            const uint64_t droppedCount = ring.header->droppedCount.load(std::memory_order_relaxed);
+            if(droppedCount != ring.reportedDroppedCount)
+            {
+                std::fprintf(stderr, "process %lld dropped %llu records, its ring was full\n", static_cast<long long>(ring.header->processId), static_cast<unsigned long long>(droppedCount - ring.reportedDroppedCount));
+                ring.reportedDroppedCount = droppedCount;
+            }
+
+            if(finished)
+            {
+                const auto path = ring.path;
+                it = rings.erase(it);
+
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+            else
+                ++it;
+        }
+
+        const int64_t writtenBefore = std::chrono::duration_cast<std::chrono::nanoseconds>((std::chrono::system_clock::now() - reorderWindow).time_since_epoch()).count();
+        bool written = false;
+
+        while(!pending.empty() && (stopping || pending.top().time <= writtenBefore))
+        {
+            const auto& line = pending.top().line;
+            std::fwrite(line.data(), 1, line.size(), output);
+            pending.pop();
+
+            written = true;
+        }
+
+        if(written)
+            std::fflush(output);
+
+        if(stopping)
+            break;
+
+        if(pending.size() == pendingBefore && !written)
+            std::this_thread::sleep_for(idleSleep);
+    }
+
+    if(output != stdout)
+        std::fclose(output);
+
+    return 0;
+}
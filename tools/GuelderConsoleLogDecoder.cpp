@@ -0,0 +1,378 @@
+#include "../include/GuelderConsoleLogBinary.hpp"
+#include "../include/GuelderConsoleLogMappedFile.hpp"
+
+#include <cstdio>
+#include <unordered_map>
+
+//turns a file written by GuelderConsoleLog::BinaryLogger into the same text, which Logger::WriteLog writes(without colors)
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        /**
+         * \brief Reads values from a byte range, every Read fails once the range is exhausted.
+         */
+        class ByteReader final
+        {
+        public:
+            explicit ByteReader(const std::string_view& bytes)
+                : bytes(bytes) {}
+
+            template<typename T>
+            bool Read(T& value)
+            {
+                static_assert(std::is_trivially_copyable_v<T>);
+
+                if(bytes.size() < sizeof(T))
+                    return false;
+
+                std::memcpy(&value, bytes.data(), sizeof(T));
+                bytes.remove_prefix(sizeof(T));
+
+                return true;
+            }
+            bool Read(std::string_view& value, const size_t& size)
+            {
+                if(bytes.size() < size)
+                    return false;
+
+                value = bytes.substr(0, size);
+                bytes.remove_prefix(size);
+
+                return true;
+            }
+
+            [[nodiscard]]
+            bool IsEmpty() const
+            {
+                return bytes.empty();
+            }
+
+        private:
+            std::string_view bytes;
+        };
+
+        struct Header final
+        {
+            TimestampPrecision precision = TimestampPrecision::Seconds;
+            TimestampZone zone = TimestampZone::Local;
+            int32_t utcOffset = 0;
+        };
+
+        /**
+         * \brief Appends "HH:MM:SS[.fraction] " the same way as Logger::AppendTime, local time is made with the UTC offset of the writing machine,
+         * which the header and the UTCOffset entries tell.
+         */
+        void AppendTime(std::string& line, const Header& header, const int64_t& nanoseconds)
+        {
+            const int64_t second = nanoseconds >= 0 ? nanoseconds / 1'000'000'000 : (nanoseconds + 1) / 1'000'000'000 - 1;
+            const int64_t shifted = header.zone == TimestampZone::UTC ? second : second + header.utcOffset;
+            const int64_t secondOfDay = (shifted % 86400 + 86400) % 86400;
+
+            const int hour = static_cast<int>(secondOfDay / 3600);
+            const int minute = static_cast<int>(secondOfDay / 60 % 60);
+            const int secondOfMinute = static_cast<int>(secondOfDay % 60);
+
+            const char text[] =
+            {
+                static_cast<char>('0' + hour / 10), static_cast<char>('0' + hour % 10), ':',
+                static_cast<char>('0' + minute / 10), static_cast<char>('0' + minute % 10), ':',
+                static_cast<char>('0' + secondOfMinute / 10), static_cast<char>('0' + secondOfMinute % 10)
+            };
+            line.append(text, sizeof(text));
+
+            const size_t digitsCount = static_cast<size_t>(header.precision) * 3;
+
+            if(digitsCount != 0)
+            {
+                char fraction[10];
+                fraction[0] = '.';
+
+                uint32_t value = static_cast<uint32_t>(nanoseconds - second * 1'000'000'000);
+                for(size_t i = digitsCount; i < 9; i += 3)
+                    value /= 1000;
+
+                for(size_t i = digitsCount; i > 0; --i)
+                {
+                    fraction[i] = static_cast<char>('0' + value % 10);
+                    value /= 10;
+                }
+
+                line.append(fraction, digitsCount + 1);
+            }
+
+            line.push_back(' ');
+        }
+
+        template<typename T>
+        bool AppendNumber(std::string& line, ByteReader& reader)
+        {
+            T value;
+            if(!reader.Read(value))
+                return false;
+
+            Formatting::Append(line, value);
+
+            return true;
+        }
+
+        bool AppendArg(std::string& line, ByteReader& reader, const BinaryArgType& type)
+        {
+            switch(type)
+            {
+            case BinaryArgType::Bool:
+            {
+                uint8_t value;
+                if(!reader.Read(value))
+                    return false;
+
+                Formatting::Append(line, value != 0);
+                return true;
+            }
+            case BinaryArgType::Char:
+            {
+                char value;
+                if(!reader.Read(value))
+                    return false;
+
+                line.push_back(value);
+                return true;
+            }
+            case BinaryArgType::WideChar:
+            {
+                uint32_t value;
+                if(!reader.Read(value))
+                    return false;
+
+                const wchar_t wideChar = static_cast<wchar_t>(value);
+                AppendUTF8(line, std::wstring_view{ &wideChar, 1 });
+
+                return true;
+            }
+            case BinaryArgType::Int8:
+                return AppendNumber<int8_t>(line, reader);
+            case BinaryArgType::Int16:
+                return AppendNumber<int16_t>(line, reader);
+            case BinaryArgType::Int32:
+                return AppendNumber<int32_t>(line, reader);
+            case BinaryArgType::Int64:
+                return AppendNumber<int64_t>(line, reader);
+            case BinaryArgType::UInt8:
+                return AppendNumber<uint8_t>(line, reader);
+            case BinaryArgType::UInt16:
+                return AppendNumber<uint16_t>(line, reader);
+            case BinaryArgType::UInt32:
+                return AppendNumber<uint32_t>(line, reader);
+            case BinaryArgType::UInt64:
+                return AppendNumber<uint64_t>(line, reader);
+            case BinaryArgType::Float:
+                return AppendNumber<float>(line, reader);
+            case BinaryArgType::Double:
+                return AppendNumber<double>(line, reader);
+            case BinaryArgType::String:
+            {
+                uint32_t size;
+                std::string_view value;
+                if(!reader.Read(size) || !reader.Read(value, size))
+                    return false;
+
+                line.append(value);
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * \brief Call site as it is stored in the file, the name points into the file's bytes.
+         */
+        struct DecodedCallSite final
+        {
+            std::string_view categoryName;
+            LogLevel level = LogLevel::Info;
+            bool writeTime = false;
+            std::vector<BinaryArgType> argTypes;
+        };
+
+        bool ReadCallSite(ByteReader& reader, uint32_t& id, DecodedCallSite& callSite)
+        {
+            uint8_t level, writeTime;
+            uint16_t nameSize, argsCount;
+
+            if(!reader.Read(id) || !reader.Read(level) || !reader.Read(writeTime) ||
+                !reader.Read(nameSize) || !reader.Read(callSite.categoryName, nameSize) || !reader.Read(argsCount))
+                return false;
+
+            callSite.level = static_cast<LogLevel>(level);
+            callSite.writeTime = writeTime != 0;
+
+            callSite.argTypes.resize(argsCount);
+            for(auto& type : callSite.argTypes)
+                if(!reader.Read(type))
+                    return false;
+
+            return true;
+        }
+
+        bool DecodeRecord(std::string& line, ByteReader& reader, const Header& header, const std::unordered_map<uint32_t, DecodedCallSite>& callSites)
+        {
+            uint32_t id;
+            if(!reader.Read(id))
+                return false;
+
+            const auto found = callSites.find(id);
+            if(found == callSites.end())
+                return false;
+
+            const DecodedCallSite& callSite = found->second;
+
+            if(callSite.writeTime)
+            {
+                int64_t nanoseconds;
+                if(!reader.Read(nanoseconds))
+                    return false;
+
+                AppendTime(line, header, nanoseconds);
+            }
+
+            line.append(callSite.categoryName);
+            line.append(": ");
+            line.append(GetLogLevelTag(callSite.level));
+            line.append(": ");
+
+            uint16_t contextSize;
+            std::string_view context;
+            if(!reader.Read(contextSize) || !reader.Read(context, contextSize))
+                return false;
+
+            if(!context.empty())
+            {
+                //without the leading space, the prefix ends with one
+                line.append(context.substr(1));
+                line.push_back(' ');
+            }
+
+            for(const auto& type : callSite.argTypes)
+                if(!AppendArg(line, reader, type))
+                    return false;
+
+            line.push_back('\n');
+
+            return reader.IsEmpty();
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace GuelderConsoleLog;
+
+    if(argc < 2 || argc > 3)
+    {
+        std::fprintf(stderr, "usage: GuelderConsoleLogDecoder <binary log> [output file]\n");
+        return 1;
+    }
+
+    //call sites point into the mapped bytes
+    const auto file = MappedFile::OpenReadOnly(argv[1]);
+    if(!file)
+    {
+        std::fprintf(stderr, "failed to open \"%s\" or it is empty\n", argv[1]);
+        return 1;
+    }
+
+    const std::string_view bytes{ file->GetData(), file->GetSize() };
+
+    std::FILE* output = argc == 3 ? std::fopen(argv[2], "wb") : stdout;
+    if(!output)
+    {
+        std::fprintf(stderr, "failed to open \"%s\"\n", argv[2]);
+        return 1;
+    }
+
+    ByteReader reader{ bytes };
+
+    std::string_view magic;
+    uint32_t version;
+    uint8_t precision, zone;
+    Header header;
+
+    if(!reader.Read(magic, sizeof(BinaryFormat::magic)) || magic != std::string_view{ BinaryFormat::magic, sizeof(BinaryFormat::magic) } ||
+        !reader.Read(version) || version != BinaryFormat::version ||
+        !reader.Read(precision) || !reader.Read(zone) || !reader.Read(header.utcOffset))
+    {
+        std::fprintf(stderr, "\"%s\" is not a binary log of a supported version\n", argv[1]);
+        return 1;
+    }
+
+    header.precision = static_cast<TimestampPrecision>(precision);
+    header.zone = static_cast<TimestampZone>(zone);
+
+    std::unordered_map<uint32_t, DecodedCallSite> callSites;
+    std::string text;
+    //a record is decoded here and is added to text only if it is whole
+    std::string line;
+
+    int result = 0;
+
+    while(!reader.IsEmpty())
+    {
+        BinaryFormat::EntryKind kind;
+        uint32_t size;
+        std::string_view payload;
+
+        if(!reader.Read(kind) || !reader.Read(size) || !reader.Read(payload, size))
+        {
+            //the writer was killed in the middle of an entry
+            std::fprintf(stderr, "the log is truncated\n");
+            result = 1;
+            break;
+        }
+
+        ByteReader payloadReader{ payload };
+        bool isValid;
+
+        if(kind == BinaryFormat::EntryKind::CallSite)
+        {
+            uint32_t id;
+            DecodedCallSite callSite;
+
+            isValid = ReadCallSite(payloadReader, id, callSite);
+            if(isValid)
+                callSites[id] = std::move(callSite);
+        }
+        else if(kind == BinaryFormat::EntryKind::Record)
+        {
+            line.clear();
+
+            isValid = DecodeRecord(line, payloadReader, header, callSites);
+            if(isValid)
+                text.append(line);
+        }
+        else if(kind == BinaryFormat::EntryKind::UTCOffset)
+            isValid = payloadReader.Read(header.utcOffset) && payloadReader.IsEmpty();
+        else
+            isValid = false;
+
+        if(!isValid)
+        {
+            std::fprintf(stderr, "the log is corrupted\n");
+            result = 1;
+            break;
+        }
+
+        if(text.size() >= (1 << 20))
+        {
+            std::fwrite(text.data(), 1, text.size(), output);
+            text.clear();
+        }
+    }
+
+    std::fwrite(text.data(), 1, text.size(), output);
+
+    if(output != stdout)
+        std::fclose(output);
+
+    return result;
+}
@@ -0,0 +1,258 @@
+#include "../include/GuelderConsoleLogCompression.hpp"
+#include "../include/GuelderConsoleLogMappedFile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+//turns a file written by GuelderConsoleLog::FileSink with Options::compress back into text, can write only the frames of a time range
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        constexpr int64_t nanosecondsPerSecond = 1'000'000'000;
+
+        struct Frame final
+        {
+            uint64_t offset = 0;
+            CompressedFormat::FrameHeader header{};
+            const char* data = nullptr;
+        };
+
+        /**
+         * \brief Reads a frame header at offset, if there is a damaged one, looks for the next valid header.
+         * \return false at the end of the file(a partial frame at the end is being written or was cut off).
+         */
+        bool ReadFrame(const std::string_view& file, uint64_t offset, Frame& frame, uint64_t& skippedBytes)
+        {
+            using namespace CompressedFormat;
+
+            skippedBytes = 0;
+
+            while(file.size() - offset >= sizeof(FrameHeader))
+            {
+                std::memcpy(&frame.header, file.data() + offset, sizeof(FrameHeader));
+
+                if(IsValid(frame.header) && file.size() - offset - sizeof(FrameHeader) >= frame.header.compressedSize)
+                {
+                    frame.offset = offset;
+                    frame.data = file.data() + offset + sizeof(FrameHeader);
+                    return true;
+                }
+
+                //the next frame starts with the magic
+                const size_t next = file.find(std::string_view{ magic, sizeof(magic) }, offset + 1);
+                const uint64_t nextOffset = next == std::string_view::npos ? file.size() : next;
+
+                skippedBytes += nextOffset - offset;
+                offset = nextOffset;
+            }
+
+            return false;
+        }
+
+        std::string FormatTime(const int64_t& nanoseconds)
+        {
+            const time_t seconds = static_cast<time_t>(nanoseconds / nanosecondsPerSecond);
+
+            tm localTime;
+#ifdef WIN32
+            localtime_s(&localTime, &seconds);
+#else
+            localtime_r(&seconds, &localTime);
+#endif
+
+            char text[32];
+            const size_t size = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &localTime);
+            std::snprintf(text + size, sizeof(text) - size, ".%03d", static_cast<int>(nanoseconds % nanosecondsPerSecond / 1'000'000));
+
+            return text;
+        }
+        /**
+         * \brief Accepts "YYYY-MM-DD HH:MM:SS" of the local time or seconds since the epoch.
+         */
+        bool ParseTime(const std::string& text, int64_t& nanoseconds)
+        {
+            if(!text.empty() && text.find_first_not_of("0123456789.") == std::string::npos)
+            {
+                nanoseconds = static_cast<int64_t>(std::strtod(text.c_str(), nullptr) * static_cast<double>(nanosecondsPerSecond));
+                return true;
+            }
+
+            tm localTime{};
+            std::istringstream stream{ text };
+            stream >> std::get_time(&localTime, "%Y-%m-%d %H:%M:%S");
+
+            if(stream.fail())
+                return false;
+
+            localTime.tm_isdst = -1;
+            nanoseconds = static_cast<int64_t>(std::mktime(&localTime)) * nanosecondsPerSecond;
+
+            return true;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace GuelderConsoleLog;
+
+    const auto printUsage = []
+        {
+            std::fprintf(stderr,
+                "usage: GuelderConsoleLogDecompressor [options] <compressed log> [output file]\n"
+                "  --list         writes the offset, the records count, the sizes and the time range of every frame instead of the text\n"
+                "  --from <time>  skips the frames, which end before the time\n"
+                "  --to <time>    skips the frames, which begin after the time\n"
+                "the time is \"YYYY-MM-DD HH:MM:SS\" of the local time or seconds since the epoch, the frames in the range are written entirely\n");
+        };
+
+    bool listOnly = false;
+    int64_t from = std::numeric_limits<int64_t>::min();
+    int64_t to = std::numeric_limits<int64_t>::max();
+    std::vector<std::string> paths;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string_view argument = argv[i];
+
+        if(argument == "--list")
+            listOnly = true;
+        else if((argument == "--from" || argument == "--to") && i + 1 < argc)
+        {
+            if(!ParseTime(argv[++i], argument == "--from" ? from : to))
+            {
+                std::fprintf(stderr, "invalid time \"%s\"\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(argument.starts_with("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+            paths.emplace_back(argument);
+    }
+
+    if(paths.empty() || paths.size() > 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto file = MappedFile::OpenReadOnly(paths[0]);
+    if(!file)
+    {
+        //a file, which was just created, has no frames yet
+        std::error_code error;
+        const bool isEmpty = std::filesystem::is_regular_file(paths[0], error) && std::filesystem::file_size(paths[0], error) == 0;
+
+        if(!isEmpty)
+        {
+            std::fprintf(stderr, "failed to open \"%s\"\n", paths[0].c_str());
+            return 1;
+        }
+    }
+
+    std::FILE* output = paths.size() == 2 ? std::fopen(paths[1].c_str(), "wb") : stdout;
+    if(!output)
+    {
+        std::fprintf(stderr, "failed to open \"%s\"\n", paths[1].c_str());
+        return 1;
+    }
+
+    const std::string_view text = file ? std::string_view{ file->GetData(), file->GetSize() } : std::string_view{};
+
+    std::vector<char> decompressed;
+    bool damaged = false;
+
+    const auto writeFrame = [&](const Frame& frame)
+        {
+            const auto& header = frame.header;
+
+            if(listOnly)
+            {
+                const std::string timeRange = header.recordsCount != 0 ? FormatTime(header.minTime) + " - " + FormatTime(header.maxTime) : "a part of a line";
+
+                std::fprintf(output, "offset %llu: %u records, %u -> %u bytes, %s\n",
+                    static_cast<unsigned long long>(frame.offset), header.recordsCount, header.uncompressedSize, header.compressedSize, timeRange.c_str());
+                return;
+            }
+
+            bool isIntact;
+            if((header.flags & CompressedFormat::storedFlag) != 0)
+            {
+                isIntact = header.compressedSize == header.uncompressedSize;
+                if(isIntact)
+                    std::fwrite(frame.data, 1, header.uncompressedSize, output);
+            }
+            else
+            {
+                decompressed.resize(header.uncompressedSize);
+
+                isIntact = Compression::Decompress(frame.data, header.compressedSize, decompressed.data(), decompressed.size());
+                if(isIntact)
+                    std::fwrite(decompressed.data(), 1, decompressed.size(), output);
+            }
+
+            if(!isIntact)
+            {
+                std::fprintf(stderr, "the frame at offset %llu is damaged, it is skipped\n", static_cast<unsigned long long>(frame.offset));
+                damaged = true;
+            }
+        };
+
+    uint64_t offset = 0;
+    Frame frame;
+    uint64_t skippedBytes;
+
+    //frames without records hold the beginning of a long line, they are written only along with the frame, where the line ends
+    std::vector<Frame> lineBeginnings;
+
+    while(ReadFrame(text, offset, frame, skippedBytes))
+    {
+        const auto& header = frame.header;
+        offset = frame.offset + sizeof(header) + header.compressedSize;
+
+        if(skippedBytes != 0)
+        {
+            std::fprintf(stderr, "%llu damaged bytes are skipped before offset %llu\n", static_cast<unsigned long long>(skippedBytes), static_cast<unsigned long long>(frame.offset));
+            damaged = true;
+            lineBeginnings.clear();
+        }
+
+        if(header.recordsCount == 0)
+        {
+            lineBeginnings.push_back(frame);
+            continue;
+        }
+
+        if(header.maxTime >= from && header.minTime <= to)
+        {
+            for(const auto& beginning : lineBeginnings)
+                writeFrame(beginning);
+
+            writeFrame(frame);
+        }
+
+        lineBeginnings.clear();
+    }
+
+    //the line at the end isn't finished yet
+    if(to == std::numeric_limits<int64_t>::max())
+        for(const auto& beginning : lineBeginnings)
+            writeFrame(beginning);
+
+    if(offset != text.size())
+        std::fprintf(stderr, "the last %llu bytes aren't a complete frame\n", static_cast<unsigned long long>(text.size() - offset));
+
+    if(output != stdout)
+        std::fclose(output);
+
+    return damaged ? 2 : 0;
+}
@@ -0,0 +1,861 @@
+#include "../include/GuelderConsoleLogMappedFile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <thread>
+
+//searches text files written by GuelderConsoleLog(FileSink, redirected standard output) by category, level, time of day and substring,
+//a side index(file.geidx) lets it skip the blocks, which can't have a matching line
+namespace GuelderConsoleLog
+{
+    namespace
+    {
+        //blocks end at the first '\n' after this many bytes, they are indexed and scanned in parallel
+        constexpr uint64_t blockSize = 1 << 20;
+        //the index belongs to the file, whose first bytes have the same hash
+        constexpr uint64_t fingerprintSize = 4096;
+
+        constexpr int64_t nanosecondsPerSecond = 1'000'000'000;
+
+        /**
+         * \brief Layout of file.geidx: Header, then entriesCount entries. Numbers are stored in the byte order of the writing machine.
+         */
+        namespace IndexFormat
+        {
+            constexpr char magic[8] = { 'G', 'E', 'L', 'O', 'G', 'I', 'D', 'X' };
+            constexpr uint32_t version = 1;
+
+            constexpr std::string_view fileExtension = ".geidx";
+
+            struct Header final
+            {
+                char magic[8];
+                uint32_t version;
+                uint32_t entrySize;
+                uint64_t blockSize;
+                //of the first min(fingerprintSize, file size) bytes
+                uint64_t fingerprint;
+                uint64_t fingerprintSize;
+                uint64_t entriesCount;
+            };
+
+            //flags of Entry
+            constexpr uint32_t hasStructuredLines = 1 << 0;
+            constexpr uint32_t hasUnparsedLines = 1 << 1;
+
+            struct Entry final
+            {
+                uint64_t begin;
+                //after the last '\n' of the block
+                uint64_t end;
+                //nanoseconds since midnight of the lines with time, minTime > maxTime if there are none
+                int64_t minTime;
+                int64_t maxTime;
+                //bit(hash of the name % 64) of every category
+                uint64_t categories;
+                //LogLevel bits of the lines
+                uint32_t levels;
+                uint32_t flags;
+            };
+        }
+
+        uint64_t Hash(const std::string_view& bytes)
+        {
+            //FNV-1a
+            uint64_t hash = 14695981039346656037ull;
+
+            for(const char& byte : bytes)
+            {
+                hash ^= static_cast<unsigned char>(byte);
+                hash *= 1099511628211ull;
+            }
+
+            return hash;
+        }
+        uint64_t GetCategoryBit(const std::string_view& name)
+        {
+            return uint64_t{ 1 } << (Hash(name) % 64);
+        }
+
+        /**
+         * \return Position of the first byte in [begin, end), end if there is none.
+         */
+        const char* FindByte(const char* begin, const char* end, const char& byte)
+        {
+            const char* current = begin;
+
+#ifdef __AVX2__
+            const __m256i wanted = _mm256_set1_epi8(byte);
+
+            for(; end - current >= 32; current += 32)
+            {
+                const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(current)), wanted)));
+                if(mask != 0)
+                    return current + std::countr_zero(mask);
+            }
+#endif
+#ifdef GE_SSE2
+            const __m128i wanted16 = _mm_set1_epi8(byte);
+
+            for(; end - current >= 16; current += 16)
+            {
+                const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(current)), wanted16)));
+                if(mask != 0)
+                    return current + std::countr_zero(mask);
+            }
+#endif
+
+            for(; current != end; ++current)
+                if(*current == byte)
+                    return current;
+
+            return end;
+        }
+
+        /**
+         * \brief Compares the first and the last byte of the pattern at 16(32 with AVX2) positions at once, only the candidates are compared entirely.
+         * \return Position of the first occurrence in [begin, end), end if there is none.
+         */
+        const char* FindPattern(const char* begin, const char* end, const std::string_view& pattern)
+        {
+            if(pattern.empty())
+                return begin;
+            if(pattern.size() == 1)
+                return FindByte(begin, end, pattern.front());
+            if(static_cast<size_t>(end - begin) < pattern.size())
+                return end;
+
+            const size_t lastOffset = pattern.size() - 1;
+            const char* current = begin;
+
+            const auto findCandidates = [&](const char* position, uint32_t mask) -> const char*
+                {
+                    for(; mask != 0; mask &= mask - 1)
+                    {
+                        const char* candidate = position + std::countr_zero(mask);
+                        if(std::memcmp(candidate + 1, pattern.data() + 1, pattern.size() - 2) == 0)
+                            return candidate;
+                    }
+
+                    return nullptr;
+                };
+
+#ifdef __AVX2__
+            {
+                const __m256i first = _mm256_set1_epi8(pattern.front());
+                const __m256i last = _mm256_set1_epi8(pattern.back());
+
+                for(; static_cast<size_t>(end - current) >= lastOffset + 32; current += 32)
+                {
+                    const __m256i firstBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current));
+                    const __m256i lastBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current + lastOffset));
+
+                    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(firstBytes, first), _mm256_cmpeq_epi8(lastBytes, last))));
+
+                    if(mask != 0)
+                        if(const char* found = findCandidates(current, mask))
+                            return found;
+                }
+            }
+#endif
+#ifdef GE_SSE2
+            {
+                const __m128i first = _mm_set1_epi8(pattern.front());
+                const __m128i last = _mm_set1_epi8(pattern.back());
+
+                for(; static_cast<size_t>(end - current) >= lastOffset + 16; current += 16)
+                {
+                    const __m128i firstBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+                    const __m128i lastBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + lastOffset));
+
+                    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBytes, first), _mm_cmpeq_epi8(lastBytes, last))));
+
+                    if(mask != 0)
+                        if(const char* found = findCandidates(current, mask))
+                            return found;
+                }
+            }
+#endif
+
+            const std::string_view rest{ current, static_cast<size_t>(end - current) };
+            const size_t position = rest.find(pattern);
+
+            return position == std::string_view::npos ? end : current + position;
+        }
+
+        /**
+         * \brief Parses "HH:MM:SS[.fraction]" and moves position after it.
+         * \return Nanoseconds since midnight, -1 if there is no time.
+         */
+        int64_t ParseTime(const char*& position, const char* end)
+        {
+            const char* current = position;
+
+            if(end - current < 8 || current[2] != ':' || current[5] != ':')
+                return -1;
+
+            int64_t values[3];
+            for(size_t i = 0; i < 3; ++i)
+            {
+                const char high = current[i * 3];
+                const char low = current[i * 3 + 1];
+
+                if(high < '0' || high > '9' || low < '0' || low > '9')
+                    return -1;
+
+                values[i] = (high - '0') * 10 + (low - '0');
+            }
+
+            int64_t nanoseconds = ((values[0] * 60 + values[1]) * 60 + values[2]) * nanosecondsPerSecond;
+            current += 8;
+
+            if(current != end && *current == '.')
+            {
+                ++current;
+
+                int64_t scale = nanosecondsPerSecond / 10;
+                for(; current != end && *current >= '0' && *current <= '9'; ++current, scale /= 10)
+                    nanoseconds += (*current - '0') * scale;
+            }
+
+            position = current;
+
+            return nanoseconds;
+        }
+
+        LogLevel ParseLevel(const std::string_view& name)
+        {
+            for(const LogLevel& level : { LogLevel::Trace, LogLevel::Debug, LogLevel::Info, LogLevel::Warning, LogLevel::Error })
+            {
+                const std::string_view tag = GetLogLevelTag(level);
+                if(tag.substr(1, tag.size() - 2) == name)
+                    return level;
+            }
+
+            return static_cast<LogLevel>(0);
+        }
+
+        struct ParsedLine final
+        {
+            //nanoseconds since midnight, -1 if the line has no time
+            int64_t time = -1;
+            std::string_view category;
+            //0 if the line isn't a record(e.g. the continuation of a multiline message)
+            LogLevel level = static_cast<LogLevel>(0);
+            bool structured = false;
+        };
+
+        bool SkipPrefix(const char*& position, const char* end, const std::string_view& prefix)
+        {
+            if(static_cast<size_t>(end - position) < prefix.size() || std::memcmp(position, prefix.data(), prefix.size()) != 0)
+                return false;
+
+            position += prefix.size();
+            return true;
+        }
+        std::string_view ReadUntil(const char*& position, const char* end, const char& terminator)
+        {
+            const char* found = FindByte(position, end, terminator);
+            const std::string_view value{ position, static_cast<size_t>(found - position) };
+
+            position = found;
+
+            return value;
+        }
+
+        /**
+         * \brief Understands the lines of GE_LOG("HH:MM:SS Core: [INFO]: ...") and of GE_LOG_KV in both formats.
+         */
+        ParsedLine ParseLine(const std::string_view& line)
+        {
+            ParsedLine parsed;
+
+            const char* position = line.data();
+            const char* end = line.data() + line.size();
+
+            if(SkipPrefix(position, end, "{"))
+            {
+                parsed.structured = true;
+
+                if(SkipPrefix(position, end, "\"time\":\""))
+                {
+                    parsed.time = ParseTime(position, end);
+                    if(parsed.time < 0 || !SkipPrefix(position, end, "\","))
+                        return {};
+                }
+
+                if(!SkipPrefix(position, end, "\"category\":\""))
+                    return {};
+
+                parsed.category = ReadUntil(position, end, '"');
+
+                if(!SkipPrefix(position, end, "\",\"level\":\""))
+                    return {};
+
+                parsed.level = ParseLevel(ReadUntil(position, end, '"'));
+            }
+            else if(line.starts_with("time=") || line.starts_with("category="))
+            {
+                parsed.structured = true;
+
+                if(SkipPrefix(position, end, "time="))
+                {
+                    parsed.time = ParseTime(position, end);
+                    if(parsed.time < 0 || !SkipPrefix(position, end, " "))
+                        return {};
+                }
+
+                if(!SkipPrefix(position, end, "category="))
+                    return {};
+
+                parsed.category = ReadUntil(position, end, ' ');
+
+                if(!SkipPrefix(position, end, " level="))
+                    return {};
+
+                parsed.level = ParseLevel(ReadUntil(position, end, ' '));
+            }
+            else
+            {
+                parsed.time = ParseTime(position, end);
+                if(parsed.time >= 0 && !SkipPrefix(position, end, " "))
+                    return {};
+
+                parsed.category = ReadUntil(position, end, ':');
+
+                if(!SkipPrefix(position, end, ": ["))
+                    return {};
+
+                parsed.level = ParseLevel(ReadUntil(position, end, ']'));
+
+                if(!SkipPrefix(position, end, "]: "))
+                    return {};
+            }
+
+            if(parsed.level == static_cast<LogLevel>(0))
+                return {};
+
+            return parsed;
+        }
+
+        /**
+         * \brief Calls onLine with every line in [begin, end) without '\n'.
+         */
+        template<typename OnLine>
+        void ForEachLine(const char* begin, const char* end, OnLine&& onLine)
+        {
+            while(begin != end)
+            {
+                const char* lineEnd = FindByte(begin, end, '\n');
+
+                onLine(std::string_view{ begin, static_cast<size_t>(lineEnd - begin) });
+
+                begin = lineEnd == end ? end : lineEnd + 1;
+            }
+        }
+
+        IndexFormat::Entry SummarizeBlock(const char* data, const uint64_t& begin, const uint64_t& end)
+        {
+            IndexFormat::Entry entry{ begin, end, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min(), 0, 0, 0 };
+
+            ForEachLine(data + begin, data + end, [&entry](const std::string_view& line)
+                {
+                    const ParsedLine parsed = ParseLine(line);
+
+                    if(parsed.level == static_cast<LogLevel>(0))
+                    {
+                        entry.flags |= IndexFormat::hasUnparsedLines;
+                        return;
+                    }
+
+                    if(parsed.time >= 0)
+                    {
+                        entry.minTime = std::min(entry.minTime, parsed.time);
+                        entry.maxTime = std::max(entry.maxTime, parsed.time);
+                    }
+
+                    entry.categories |= GetCategoryBit(parsed.category);
+                    entry.levels |= static_cast<uint32_t>(parsed.level);
+
+                    if(parsed.structured)
+                        entry.flags |= IndexFormat::hasStructuredLines;
+                });
+
+            return entry;
+        }
+
+        /**
+         * \brief Calls work(i) for every i in [0, count) on all the threads.
+         */
+        template<typename Work>
+        void RunParallel(const size_t& count, const size_t& threadsCount, Work&& work)
+        {
+            std::atomic<size_t> next = 0;
+
+            const auto run = [&]
+                {
+                    for(size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+                        work(i);
+                };
+
+            std::vector<std::thread> threads;
+            for(size_t i = 1; i < std::min(threadsCount, count); ++i)
+                threads.emplace_back(run);
+
+            run();
+
+            for(auto& thread : threads)
+                thread.join();
+        }
+
+        std::filesystem::path GetIndexPath(const std::filesystem::path& path)
+        {
+            auto indexPath = path;
+            indexPath += IndexFormat::fileExtension;
+
+            return indexPath;
+        }
+
+        /**
+         * \return Entries of the index, which still describe the beginning of the file, empty if there is no such index.
+         */
+        std::vector<IndexFormat::Entry> LoadIndex(const std::filesystem::path& path, const std::string_view& file)
+        {
+            using namespace IndexFormat;
+
+            std::ifstream stream{ GetIndexPath(path), std::ios::binary };
+            if(!stream)
+                return {};
+
+            Header header;
+            if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+                return {};
+
+            if(std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.entrySize != sizeof(Entry) || header.blockSize != blockSize)
+                return {};
+            if(header.fingerprintSize > file.size() || header.fingerprint != Hash(file.substr(0, header.fingerprintSize)))
+                return {};
+
+            std::vector<Entry> entries(header.entriesCount);
+            if(!stream.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry))))
+                return {};
+
+            if(!entries.empty() && entries.back().end > file.size())
+                return {};
+
+            return entries;
+        }
+        /**
+         * \brief Writes a temporary file and renames it, so a concurrent query never reads a partial index. Failures are ignored, the index is only an optimization.
+         */
+        void SaveIndex(const std::filesystem::path& path, const std::string_view& file, const std::vector<IndexFormat::Entry>& entries)
+        {
+            using namespace IndexFormat;
+
+            Header header{};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.version = version;
+            header.entrySize = sizeof(Entry);
+            header.blockSize = blockSize;
+            header.fingerprintSize = std::min<uint64_t>(fingerprintSize, file.size());
+            header.fingerprint = Hash(file.substr(0, header.fingerprintSize));
+            header.entriesCount = entries.size();
+
+            const auto indexPath = GetIndexPath(path);
+            auto temporaryPath = indexPath;
+            temporaryPath += ".tmp";
+
+            {
+                std::ofstream stream{ temporaryPath, std::ios::binary | std::ios::trunc };
+
+                stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                stream.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+
+                if(!stream.flush())
+                {
+                    stream.close();
+
+                    std::error_code error;
+                    std::filesystem::remove(temporaryPath, error);
+                    return;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temporaryPath, indexPath, error);
+        }
+
+        struct Query final
+        {
+            std::vector<std::string> categories;
+            //LogLevel bits, 0 - any
+            uint32_t levels = 0;
+            int64_t from = -1;
+            int64_t to = -1;
+            std::string substring;
+
+            bool countOnly = false;
+            bool useIndex = true;
+            size_t threadsCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+            [[nodiscard]]
+            bool HasTimeRange() const
+            {
+                return from >= 0 || to >= 0;
+            }
+            [[nodiscard]]
+            bool NeedsParsing() const
+            {
+                return !categories.empty() || levels != 0 || HasTimeRange();
+            }
+
+            [[nodiscard]]
+            bool IsTimeInRange(const int64_t& time) const
+            {
+                if(time < 0)
+                    return false;
+
+                const int64_t begin = from >= 0 ? from : 0;
+                const int64_t end = to >= 0 ? to : 24 * 3600 * nanosecondsPerSecond;
+
+                //the range goes over midnight
+                if(begin > end)
+                    return time >= begin || time <= end;
+
+                return time >= begin && time <= end;
+            }
+
+            [[nodiscard]]
+            bool MayMatch(const IndexFormat::Entry& entry) const
+            {
+                //lines, which aren't records, match only a substring
+                if(NeedsParsing() && entry.levels == 0)
+                    return false;
+                if(levels != 0 && (entry.levels & levels) == 0)
+                    return false;
+
+                if(!categories.empty() && std::none_of(categories.begin(), categories.end(), [&entry](const std::string& category) { return (entry.categories & GetCategoryBit(category)) != 0; }))
+                    return false;
+
+                if(HasTimeRange())
+                {
+                    if(entry.minTime > entry.maxTime)
+                        return false;
+
+                    const int64_t begin = from >= 0 ? from : 0;
+                    const int64_t end = to >= 0 ? to : 24 * 3600 * nanosecondsPerSecond;
+
+                    //a block with the whole range inside the gap of the query can be skipped, over midnight only the gap is checked
+                    if(begin <= end)
+                        return entry.maxTime >= begin && entry.minTime <= end;
+
+                    return !(entry.minTime > end && entry.maxTime < begin);
+                }
+
+                return true;
+            }
+
+            [[nodiscard]]
+            bool Matches(const std::string_view& line) const
+            {
+                if(NeedsParsing())
+                {
+                    const ParsedLine parsed = ParseLine(line);
+
+                    if(parsed.level == static_cast<LogLevel>(0))
+                        return false;
+                    if(levels != 0 && (static_cast<uint32_t>(parsed.level) & levels) == 0)
+                        return false;
+                    if(!categories.empty() && std::find(categories.begin(), categories.end(), parsed.category) == categories.end())
+                        return false;
+                    if(HasTimeRange() && !IsTimeInRange(parsed.time))
+                        return false;
+                }
+
+                return substring.empty() || FindPattern(line.data(), line.data() + line.size(), substring) != line.data() + line.size();
+            }
+
+            /**
+             * \brief A text every matching line of a block without structured lines contains, it is searched instead of parsing every line.
+             */
+            [[nodiscard]]
+            std::string GetPlainPattern() const
+            {
+                if(!substring.empty())
+                    return substring;
+
+                const bool oneLevel = std::has_single_bit(levels);
+                std::string_view tag;
+                if(oneLevel)
+                    tag = GetLogLevelTag(static_cast<LogLevel>(levels));
+
+                if(categories.size() == 1)
+                    return oneLevel ? Logger::Format(categories.front(), ": ", tag, ": ") : Logger::Format(categories.front(), ": [");
+                if(oneLevel)
+                    return Logger::Format(tag, ": ");
+
+                return {};
+            }
+        };
+
+        struct BlockResult final
+        {
+            std::string lines;
+            uint64_t count = 0;
+        };
+
+        void ScanBlock(const char* data, const IndexFormat::Entry& entry, const Query& query, const std::string& plainPattern, BlockResult& result)
+        {
+            const auto onMatch = [&query, &result](const std::string_view& line)
+                {
+                    ++result.count;
+
+                    if(!query.countOnly)
+                    {
+                        result.lines.append(line);
+                        result.lines.push_back('\n');
+                    }
+                };
+
+            const char* begin = data + entry.begin;
+            const char* end = data + entry.end;
+
+            const std::string& pattern = (entry.flags & IndexFormat::hasStructuredLines) != 0 ? query.substring : plainPattern;
+
+            if(pattern.empty())
+            {
+                ForEachLine(begin, end, [&query, &onMatch](const std::string_view& line)
+                    {
+                        if(query.Matches(line))
+                            onMatch(line);
+                    });
+
+                return;
+            }
+
+            //only the lines around the occurrences of the pattern are looked at
+            for(const char* current = begin; current != end;)
+            {
+                const char* found = FindPattern(current, end, pattern);
+                if(found == end)
+                    break;
+
+                const size_t lineBegin = std::string_view{ current, static_cast<size_t>(found - current) }.rfind('\n');
+                const char* lineStart = lineBegin == std::string_view::npos ? current : current + lineBegin + 1;
+                const char* lineEnd = FindByte(found, end, '\n');
+
+                const std::string_view line{ lineStart, static_cast<size_t>(lineEnd - lineStart) };
+                if(query.Matches(line))
+                    onMatch(line);
+
+                current = lineEnd == end ? end : lineEnd + 1;
+            }
+        }
+
+        /**
+         * \return Count of matching lines.
+         */
+        uint64_t QueryFile(const std::filesystem::path& path, const Query& query, std::FILE* output)
+        {
+            const auto file = MappedFile::OpenReadOnly(path);
+            if(!file)
+            {
+                std::error_code error;
+                if(std::filesystem::is_regular_file(path, error) && std::filesystem::file_size(path, error) == 0)
+                    return 0;
+
+                std::fprintf(stderr, "failed to open \"%s\"\n", path.string().c_str());
+                return 0;
+            }
+
+            const char* data = file->GetData();
+            const std::string_view text{ data, file->GetSize() };
+
+            std::vector<IndexFormat::Entry> entries;
+            if(query.useIndex)
+                entries = LoadIndex(path, text);
+
+            const size_t loadedCount = entries.size();
+
+            //the rest of the file is split into blocks, which end after a '\n', the last one may be a partial line being written now
+            std::vector<uint64_t> boundaries{ entries.empty() ? 0 : entries.back().end };
+            while(boundaries.back() != text.size())
+            {
+                const uint64_t begin = std::min<uint64_t>(boundaries.back() + blockSize, text.size());
+                const char* found = FindByte(data + begin, data + text.size(), '\n');
+
+                boundaries.push_back(found == data + text.size() ? text.size() : static_cast<uint64_t>(found - data) + 1);
+            }
+
+            entries.resize(loadedCount + boundaries.size() - 1);
+
+            RunParallel(boundaries.size() - 1, query.threadsCount, [&](const size_t& i)
+                {
+                    entries[loadedCount + i] = SummarizeBlock(data, boundaries[i], boundaries[i + 1]);
+                });
+
+            if(query.useIndex && entries.size() != loadedCount)
+            {
+                //the partial line at the end is indexed when it is complete
+                const size_t completeCount = text.back() == '\n' ? entries.size() : entries.size() - 1;
+
+                if(completeCount > loadedCount)
+                    SaveIndex(path, text, { entries.begin(), entries.begin() + completeCount });
+            }
+
+            std::vector<const IndexFormat::Entry*> candidates;
+            for(const auto& entry : entries)
+                if(query.MayMatch(entry))
+                    candidates.push_back(&entry);
+
+            const std::string plainPattern = query.GetPlainPattern();
+
+            uint64_t count = 0;
+
+            //results are kept for a batch of blocks at a time and written in the order of the file
+            const size_t batchSize = query.threadsCount * 4;
+            std::vector<BlockResult> results(batchSize);
+
+            for(size_t batchBegin = 0; batchBegin < candidates.size(); batchBegin += batchSize)
+            {
+                const size_t batchCount = std::min(batchSize, candidates.size() - batchBegin);
+
+                RunParallel(batchCount, query.threadsCount, [&](const size_t& i)
+                    {
+                        results[i].lines.clear();
+                        results[i].count = 0;
+
+                        ScanBlock(data, *candidates[batchBegin + i], query, plainPattern, results[i]);
+                    });
+
+                for(size_t i = 0; i < batchCount; ++i)
+                {
+                    count += results[i].count;
+                    std::fwrite(results[i].lines.data(), 1, results[i].lines.size(), output);
+                }
+            }
+
+            return count;
+        }
+
+        bool ParseLevels(const std::string_view& list, uint32_t& levels)
+        {
+            for(size_t begin = 0; begin <= list.size();)
+            {
+                size_t end = list.find(',', begin);
+                if(end == std::string_view::npos)
+                    end = list.size();
+
+                std::string name{ list.substr(begin, end - begin) };
+                std::transform(name.begin(), name.end(), name.begin(), [](const char& c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+
+                const LogLevel level = ParseLevel(name);
+                if(level == static_cast<LogLevel>(0))
+                    return false;
+
+                levels |= static_cast<uint32_t>(level);
+                begin = end + 1;
+            }
+
+            return true;
+        }
+        bool ParseTimeArgument(const std::string_view& argument, int64_t& time, const bool& roundUp)
+        {
+            const char* position = argument.data();
+            const char* end = argument.data() + argument.size();
+
+            time = ParseTime(position, end);
+            if(time < 0 || position != end)
+                return false;
+
+            //"12:00:00" as the end of the range includes the whole second
+            if(roundUp && argument.size() == 8)
+                time += nanosecondsPerSecond - 1;
+
+            return true;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace GuelderConsoleLog;
+
+    const auto printUsage = []
+        {
+            std::fprintf(stderr,
+                "usage: GuelderConsoleLogQuery [options] <log file>...\n"
+                "  --category <name>             lines of the category, can be repeated\n"
+                "  --level <level>[,<level>...]  lines of the levels: TRACE, DEBUG, INFO, WARNING, ERROR\n"
+                "  --from <HH:MM:SS[.fraction]>  lines written at this time of day or later\n"
+                "  --to <HH:MM:SS[.fraction]>    lines written at this time of day or earlier\n"
+                "  --grep <text>                 lines containing the text\n"
+                "  --count                       writes only the count of matching lines\n"
+                "  --no-index                    doesn't read or write the side index(<log file>.geidx)\n"
+                "  --threads <count>             default is the count of hardware threads\n");
+        };
+
+    Query query;
+    std::vector<std::filesystem::path> paths;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if(argument == "--category" && hasValue)
+            query.categories.emplace_back(argv[++i]);
+        else if(argument == "--level" && hasValue)
+        {
+            if(!ParseLevels(argv[++i], query.levels))
+            {
+                std::fprintf(stderr, "invalid level list \"%s\"\n", argv[i]);
+                return 1;
+            }
+        }
+        else if((argument == "--from" || argument == "--to") && hasValue)
+        {
+            if(!ParseTimeArgument(argv[++i], argument == "--from" ? query.from : query.to, argument == "--to"))
+            {
+                std::fprintf(stderr, "invalid time \"%s\", expected HH:MM:SS[.fraction]\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(argument == "--grep" && hasValue)
+            query.substring = argv[++i];
+        else if(argument == "--count")
+            query.countOnly = true;
+        else if(argument == "--no-index")
+            query.useIndex = false;
+        else if(argument == "--threads" && hasValue)
+            query.threadsCount = std::max(std::strtoull(argv[++i], nullptr, 10), 1ull);
+        else if(argument.starts_with("--"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+            paths.emplace_back(argument);
+    }
+
+    if(paths.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    uint64_t count = 0;
+
+    for(const auto& path : paths)
+        count += QueryFile(path, query, stdout);
+
+    if(query.countOnly)
+        std::printf("%llu\n", static_cast<unsigned long long>(count));
+
+    std::fflush(stdout);
+
+    return 0;
+}